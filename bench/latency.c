@@ -0,0 +1,261 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#define BENCH_ADDRESS "127.0.0.1"
+#define BENCH_PORT    5556
+#define BENCH_PATH    "@procom-latency"
+
+#define BENCH_TCP     0
+#define BENCH_UNIX    1
+#define BENCH_SHM     2
+
+#define BENCH_COUNT   100000
+#define BENCH_SIZE    64
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#include "../source/socket.h"
+#include "../source/shm.h"
+
+// The messages go through the shared memory rings instead of the socket
+static bool shared = false;
+
+/*
+ * Send all bytes of a message, using socket_write or shm_write
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to write to socket
+ */
+static int message_write(int sockfd, char* message, size_t size)
+{
+  while(size > 0)
+  {
+    struct iovec iovec = { .iov_base = message, .iov_len = size };
+
+    ssize_t status = shared ? shm_write(sockfd, &iovec, 1) : socket_write(sockfd, &iovec, 1);
+
+    if(status <= 0) return -1;
+
+    message += status;
+    size    -= status;
+  }
+
+  return 0;
+}
+
+/*
+ * Receive all bytes of a message, using socket_read or shm_read
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to read from socket, or end of file
+ */
+static int message_read(int sockfd, char* message, size_t size)
+{
+  while(size > 0)
+  {
+    ssize_t status = shared ? shm_read(sockfd, message, size) : socket_read(sockfd, message, size);
+
+    if(status <= 0) return -1;
+
+    message += status;
+    size    -= status;
+  }
+
+  return 0;
+}
+
+/*
+ * The peer echoes every message back, until end of file
+ */
+static void echo_peer(int sockfd, size_t size)
+{
+  char* message = malloc(size);
+
+  while(message_read(sockfd, message, size) == 0)
+  {
+    if(message_write(sockfd, message, size) == -1) break;
+  }
+
+  free(message);
+}
+
+static int latency_compare(const void* a, const void* b)
+{
+  long first = *(const long*) a, second = *(const long*) b;
+
+  return (first > second) - (first < second);
+}
+
+/*
+ * Send messages to the echo peer, one at a time, and time every round trip
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to communicate with peer
+ */
+static int latency_measure(const char* name, int sockfd, size_t count, size_t size)
+{
+  char* message = calloc(size, 1);
+
+  long* latencies = malloc(sizeof(long) * count);
+
+  if(!message || !latencies)
+  {
+    free(message);
+
+    free(latencies);
+
+    return -1;
+  }
+
+  int status = 0;
+
+  for(size_t index = 0; index < count; index++)
+  {
+    struct timespec start, stop;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if(message_write(sockfd, message, size) == -1 || message_read(sockfd, message, size) == -1)
+    {
+      status = -1;
+
+      break;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    latencies[index] = (stop.tv_sec - start.tv_sec) * 1000000000L + (stop.tv_nsec - start.tv_nsec);
+  }
+
+  if(status == 0)
+  {
+    qsort(latencies, count, sizeof(long), latency_compare);
+
+    double total = 0;
+
+    for(size_t index = 0; index < count; index++) total += latencies[index];
+
+    printf("%-6s %10.0f %10ld %10ld %10ld\n", name, total / count,
+      latencies[count / 2], latencies[count * 99 / 100], latencies[count - 1]);
+  }
+
+  free(message);
+
+  free(latencies);
+
+  return status;
+}
+
+/*
+ * Run the latency benchmark over one transport
+ *
+ * The parent creates the server, before the child connects to it as echo peer
+ */
+static int transport_bench(const char* name, int transport, size_t count, size_t size)
+{
+  int sockfd = -1, servfd = -1;
+
+  bool local = (transport != BENCH_TCP);
+
+  shared = (transport == BENCH_SHM);
+
+  int status = local ?
+    client_or_server_unix_socket_open(&sockfd, &servfd, BENCH_PATH, 1, false) :
+    client_or_server_socket_open(&sockfd, &servfd, BENCH_ADDRESS, BENCH_PORT, 1, false);
+
+  if(status != 0 || servfd == -1)
+  {
+    fprintf(stderr, "%s: Failed to create server socket\n", name);
+
+    socket_close(&sockfd, false);
+
+    return -1;
+  }
+
+  fflush(stdout);
+
+  pid_t pid = fork();
+
+  if(pid == 0)
+  {
+    socket_close(&servfd, false);
+
+    status = local ?
+      client_or_server_unix_socket_create(&sockfd, &servfd, BENCH_PATH, false) :
+      client_or_server_socket_create(&sockfd, &servfd, BENCH_ADDRESS, BENCH_PORT, false);
+
+    if(status == 0 && shared) status = shm_create(sockfd, false, false);
+
+    // The socket functions fail while errno is set
+    errno = 0;
+
+    if(status == 0) echo_peer(sockfd, size);
+
+    shm_close(false);
+
+    socket_close(&sockfd, false);
+
+    socket_close(&servfd, false);
+
+    exit(0);
+  }
+
+  sockfd = socket_accept(servfd, false);
+
+  socket_close(&servfd, false);
+
+  status = (sockfd != -1) ? 0 : -1;
+
+  if(status == 0 && shared) status = shm_create(sockfd, true, false);
+
+  errno = 0;
+
+  if(status == 0) status = latency_measure(name, sockfd, count, size);
+
+  shm_close(false);
+
+  socket_close(&sockfd, false);
+
+  waitpid(pid, NULL, 0);
+
+  return status;
+}
+
+/*
+ * Compare the round trip latency of TCP loopback, unix sockets
+ * and shared memory rings
+ *
+ * USAGE: latency [COUNT] [SIZE]
+ */
+int main(int argc, char* argv[])
+{
+  size_t count = (argc > 1) ? atol(argv[1]) : BENCH_COUNT;
+
+  size_t size  = (argc > 2) ? atol(argv[2]) : BENCH_SIZE;
+
+  if(count == 0 || size == 0) return 1;
+
+  printf("%ld round trips of %ld bytes (nanoseconds)\n", (long) count, (long) size);
+
+  printf("%-6s %10s %10s %10s %10s\n", "", "mean", "p50", "p99", "max");
+
+  int status = 0;
+
+  if(transport_bench("tcp",  BENCH_TCP,  count, size) == -1) status = 1;
+
+  if(transport_bench("unix", BENCH_UNIX, count, size) == -1) status = 1;
+
+  if(transport_bench("shm",  BENCH_SHM,  count, size) == -1) status = 1;
+
+  return status;
+}
@@ -0,0 +1,712 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#define _GNU_SOURCE
+
+#define BENCH_ADDRESS  "127.0.0.1"
+#define BENCH_PORT     5560
+#define BENCH_PATH     "@procom-bench"
+
+#define BENCH_COUNT    100000
+#define BENCH_SIZE     64
+#define BENCH_SIZE_MIN 18    // The timestamp, one byte of padding and the newline
+#define BENCH_SIZE_MAX 65536
+#define BENCH_STARTUP  200   // Milliseconds for a procom to start listening
+#define BENCH_TIMEOUT  5000  // Milliseconds without lines before giving up
+#define BENCH_BUFFER   65536
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <argp.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <libgen.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+/*
+ * A way of connecting two procoms
+ *
+ * The sender reads the generated lines from stdin or from a fifo,
+ * and the receiver writes them to stdout or to a fifo, where they are collected.
+ * The procoms are connected over TCP, or over a unix socket if local is set,
+ * and through a third procom if hub is set
+ */
+struct topology
+{
+  const char* name;
+  bool        fifo;
+  bool        local;
+  bool        hub;
+  const char* flag; // Extra flag for all procoms, or NULL
+};
+
+static const struct topology topologies[] =
+{
+  { "stdin-tcp-stdout",       false, false, false, NULL },
+  { "fifo-tcp-fifo",          true,  false, false, NULL },
+  { "fifo-unix-fifo",         true,  true,  false, NULL },
+  { "fifo-shm-fifo",          true,  true,  false, "--shm" },
+  { "fifo-tcp-fifo-raw",      true,  false, false, "--raw" },
+  { "fifo-tcp-fifo-epoll",    true,  false, false, "--epoll" },
+  { "fifo-tcp-fifo-stages",   true,  false, false, "--stages" },
+  { "fifo-tcp-fifo-compress", true,  false, false, "--compress" },
+  { "stdin-hub-stdout",       false, false, true,  NULL }
+};
+
+#define TOPOLOGY_COUNT (sizeof(topologies) / sizeof(struct topology))
+
+/*
+ * The result of running one topology
+ */
+struct result
+{
+  size_t sent;
+  size_t received;
+  size_t bytes;
+  long   stop;      // The time that the last line was received
+  double seconds;
+  long*  latencies; // One-way latency of every received line, in nanoseconds
+};
+
+/*
+ * The generator of lines, which runs on its own thread
+ */
+struct generator
+{
+  int    fd;
+  size_t count;
+  size_t size_min;
+  size_t size_max;
+  double rate;
+  size_t sent;
+  long   start;
+};
+
+static char doc[] = "procom-bench - end-to-end throughput and latency of procom";
+
+static char args_doc[] = "";
+
+static struct argp_option options[] =
+{
+  { "count",    'c', "COUNT",    0, "Number of lines per topology" },
+  { "size",     's', "MIN[-MAX]", 0, "Line size in bytes, or a range of random sizes" },
+  { "rate",     'r', "RATE",     0, "Lines per second, or 0 for as fast as possible" },
+  { "topology", 't', "NAME",     0, "Only run topologies containing NAME" },
+  { "procom",   'P', "PATH",     0, "Path of the procom binary" },
+  { "list",     'l', 0,          0, "List the topologies" },
+  { 0 }
+};
+
+struct args
+{
+  size_t count;
+  size_t size_min;
+  size_t size_max;
+  double rate;
+  char*  topology;
+  char*  procom;
+  bool   list;
+};
+
+struct args args =
+{
+  .count    = BENCH_COUNT,
+  .size_min = BENCH_SIZE,
+  .size_max = BENCH_SIZE,
+  .rate     = 0,
+  .topology = NULL,
+  .procom   = NULL,
+  .list     = false
+};
+
+/*
+ * This is the option parsing function used by argp
+ */
+static error_t opt_parse(int key, char* arg, struct argp_state* state)
+{
+  struct args* args = state->input;
+
+  switch(key)
+  {
+    case 'c':
+      args->count = atol(arg);
+      break;
+
+    case 's':
+      char* dash = strchr(arg, '-');
+
+      args->size_min = atol(arg);
+
+      args->size_max = dash ? (size_t) atol(dash + 1) : args->size_min;
+      break;
+
+    case 'r':
+      args->rate = atof(arg);
+      break;
+
+    case 't':
+      args->topology = arg;
+      break;
+
+    case 'P':
+      args->procom = arg;
+      break;
+
+    case 'l':
+      args->list = true;
+      break;
+
+    case ARGP_KEY_ARG:
+      break;
+
+    case ARGP_KEY_END:
+      if(args->count == 0)
+      {
+        argp_error(state, "--count has to be positive");
+      }
+
+      if(args->size_min < BENCH_SIZE_MIN || args->size_max > BENCH_SIZE_MAX || args->size_min > args->size_max)
+      {
+        argp_error(state, "--size has to be within %d and %d", BENCH_SIZE_MIN, BENCH_SIZE_MAX);
+      }
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+  }
+
+  return 0;
+}
+
+static struct argp argp = { options, opt_parse, args_doc, doc };
+
+/*
+ * Get the monotonic time, in nanoseconds
+ */
+static long time_now(void)
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+
+  return time.tv_sec * 1000000000L + time.tv_nsec;
+}
+
+/*
+ * Sleep until the monotonic time, in nanoseconds
+ */
+static void time_sleep_until(long time)
+{
+  struct timespec until = { .tv_sec = time / 1000000000L, .tv_nsec = time % 1000000000L };
+
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR);
+}
+
+/*
+ * Write all bytes to fd
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to write
+ */
+static int bytes_write(int fd, const char* bytes, size_t length)
+{
+  while(length > 0)
+  {
+    ssize_t status = write(fd, bytes, length);
+
+    if(status == -1)
+    {
+      if(errno == EINTR) continue;
+
+      return -1;
+    }
+
+    bytes  += status;
+    length -= status;
+  }
+
+  return 0;
+}
+
+/*
+ * Generate the lines and write them to the sender
+ *
+ * Every line starts with the time it was generated, as 16 hex digits,
+ * which the collector subtracts from the time it was received.
+ * Without a rate, the lines are written in large batches
+ */
+static void* generator_routine(void* arg)
+{
+  struct generator* generator = arg;
+
+  char* buffer = malloc(BENCH_BUFFER + BENCH_SIZE_MAX);
+
+  size_t length = 0;
+
+  unsigned int seed = 1;
+
+  generator->start = time_now();
+
+  for(size_t index = 0; index < generator->count; index++)
+  {
+    if(generator->rate > 0)
+    {
+      time_sleep_until(generator->start + (long) (index * 1e9 / generator->rate));
+    }
+
+    size_t size = generator->size_min;
+
+    if(generator->size_max > size) size += rand_r(&seed) % (generator->size_max - size + 1);
+
+    char* line = buffer + length;
+
+    snprintf(line, 17, "%016lx", time_now());
+
+    memset(line + 16, 'x', size - 17);
+
+    line[size - 1] = '\n';
+
+    length += size;
+
+    if(generator->rate > 0 || length >= BENCH_BUFFER || index + 1 == generator->count)
+    {
+      if(bytes_write(generator->fd, buffer, length) == -1) break;
+
+      length = 0;
+    }
+
+    generator->sent = index + 1;
+  }
+
+  close(generator->fd);
+
+  free(buffer);
+
+  return NULL;
+}
+
+/*
+ * Collect the lines from the receiver, and measure their latency
+ *
+ * The collection stops when every sent line has been received,
+ * at end of file, or when no lines have arrived for a while
+ */
+static void lines_collect(int fd, size_t count, struct result* result)
+{
+  char* buffer = malloc(2 * BENCH_BUFFER);
+
+  size_t length = 0;
+
+  long stop = 0;
+
+  struct pollfd pollfd = { .fd = fd, .events = POLLIN };
+
+  while(result->received < count)
+  {
+    int status = poll(&pollfd, 1, BENCH_TIMEOUT);
+
+    if(status == -1 && errno == EINTR) continue;
+
+    if(status <= 0) break;
+
+    ssize_t size = read(fd, buffer + length, 2 * BENCH_BUFFER - length);
+
+    if(size == -1 && (errno == EINTR || errno == EAGAIN)) continue;
+
+    if(size <= 0) break;
+
+    long now = time_now();
+
+    length += size;
+
+    char* start = buffer;
+
+    char* newline;
+
+    while((newline = memchr(start, '\n', length - (start - buffer))))
+    {
+      if(newline - start >= 16 && result->received < count)
+      {
+        char stamp[17];
+
+        memcpy(stamp, start, 16);
+
+        stamp[16] = '\0';
+
+        result->latencies[result->received++] = now - strtol(stamp, NULL, 16);
+      }
+
+      result->bytes += newline - start + 1;
+
+      start = newline + 1;
+    }
+
+    length -= start - buffer;
+
+    memmove(buffer, start, length);
+
+    stop = now;
+  }
+
+  result->stop = stop;
+
+  free(buffer);
+}
+
+/*
+ * Start procom with stdin and stdout redirected, and stderr silenced
+ *
+ * RETURN (pid_t pid)
+ * - >0 | Success! The pid of procom
+ * - -1 | Failed to fork
+ */
+static pid_t procom_spawn(char* argv[], int in_fd, int out_fd)
+{
+  fflush(stdout);
+
+  pid_t pid = fork();
+
+  if(pid != 0) return pid;
+
+  int null_fd = open("/dev/null", O_RDWR);
+
+  dup2((in_fd  != -1) ? in_fd  : null_fd, STDIN_FILENO);
+
+  dup2((out_fd != -1) ? out_fd : null_fd, STDOUT_FILENO);
+
+  dup2(null_fd, STDERR_FILENO);
+
+  execv(argv[0], argv);
+
+  _exit(127);
+}
+
+/*
+ * Stop procom, first politely and then by force
+ */
+static void procom_stop(pid_t pid)
+{
+  if(pid <= 0) return;
+
+  kill(pid, SIGINT);
+
+  for(int tries = 0; tries < 100; tries++)
+  {
+    if(waitpid(pid, NULL, WNOHANG) == pid) return;
+
+    usleep(10000);
+  }
+
+  kill(pid, SIGKILL);
+
+  waitpid(pid, NULL, 0);
+}
+
+/*
+ * Open a fifo, retrying until the procom at the other end has opened it
+ *
+ * RETURN (int fd)
+ * - >=0 | Success! The blocking fd of the fifo
+ * -  -1 | Failed to open fifo in time
+ */
+static int fifo_writer_open(const char* path)
+{
+  for(int waited = 0; waited < BENCH_TIMEOUT; waited += 10)
+  {
+    int fd = open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+
+    if(fd != -1)
+    {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+      return fd;
+    }
+
+    if(errno != ENXIO) return -1;
+
+    usleep(10000);
+  }
+
+  return -1;
+}
+
+/*
+ * Build the arguments of one procom
+ */
+static void procom_args_build(char* argv[], const struct topology* topology, int index, const char* path_flag, char* path)
+{
+  static char ports[3][16];
+
+  static char paths[3][64];
+
+  int count = 0;
+
+  argv[count++] = args.procom;
+
+  if(topology->local)
+  {
+    snprintf(paths[index], sizeof(paths[index]), "%s-%d", BENCH_PATH, (int) getpid());
+
+    argv[count++] = "-U";
+    argv[count++] = paths[index];
+  }
+  else
+  {
+    snprintf(ports[index], sizeof(ports[index]), "%d", BENCH_PORT + (int) (topology - topologies));
+
+    argv[count++] = "-a";
+    argv[count++] = BENCH_ADDRESS;
+    argv[count++] = "-p";
+    argv[count++] = ports[index];
+  }
+
+  if(topology->hub)  argv[count++] = "--hub";
+
+  if(topology->flag) argv[count++] = (char*) topology->flag;
+
+  if(path_flag)
+  {
+    argv[count++] = (char*) path_flag;
+    argv[count++] = path;
+  }
+
+  argv[count] = NULL;
+}
+
+/*
+ * Run one topology: start the procoms, generate and collect the lines, and stop the procoms
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to start the topology
+ */
+static int topology_run(const struct topology* topology, struct result* result)
+{
+  char in_path[64], out_path[64];
+
+  snprintf(in_path,  sizeof(in_path),  "/tmp/procom-bench-%d.in",  (int) getpid());
+
+  snprintf(out_path, sizeof(out_path), "/tmp/procom-bench-%d.out", (int) getpid());
+
+  // The pipes that keep stdin of the receiver and the hub open
+  int hold_pipe[2], in_pipe[2] = { -1, -1 }, out_pipe[2] = { -1, -1 };
+
+  if(pipe2(hold_pipe, O_CLOEXEC) == -1) return -1;
+
+  if(topology->fifo)
+  {
+    unlink(in_path);
+
+    unlink(out_path);
+
+    mkfifo(in_path,  0600);
+
+    mkfifo(out_path, 0600);
+  }
+  else
+  {
+    pipe2(in_pipe,  O_CLOEXEC);
+
+    pipe2(out_pipe, O_CLOEXEC);
+  }
+
+  pid_t pids[3] = { -1, -1, -1 };
+
+  char* argv[16];
+
+  // The hub is started first, and the receiver before the sender, to become the server
+  if(topology->hub)
+  {
+    procom_args_build(argv, topology, 2, NULL, NULL);
+
+    pids[2] = procom_spawn(argv, hold_pipe[0], -1);
+
+    usleep(BENCH_STARTUP * 1000);
+  }
+
+  procom_args_build(argv, topology, 1, topology->fifo ? "-o" : NULL, out_path);
+
+  pids[1] = procom_spawn(argv, hold_pipe[0], out_pipe[1]);
+
+  usleep(BENCH_STARTUP * 1000);
+
+  procom_args_build(argv, topology, 0, topology->fifo ? "-i" : NULL, in_path);
+
+  pids[0] = procom_spawn(argv, in_pipe[0], -1);
+
+  // Only the procoms use their ends of the pipes
+  if(!topology->fifo)
+  {
+    close(in_pipe[0]);
+
+    close(out_pipe[1]);
+  }
+
+  int collect_fd = topology->fifo ? open(out_path, O_RDONLY | O_NONBLOCK | O_CLOEXEC) : out_pipe[0];
+
+  struct generator generator =
+  {
+    .fd       = topology->fifo ? fifo_writer_open(in_path) : in_pipe[1],
+    .count    = args.count,
+    .size_min = args.size_min,
+    .size_max = args.size_max,
+    .rate     = args.rate
+  };
+
+  int status = -1;
+
+  pthread_t thread;
+
+  if(collect_fd != -1 && generator.fd != -1 && pthread_create(&thread, NULL, generator_routine, &generator) == 0)
+  {
+    lines_collect(collect_fd, args.count, result);
+
+    pthread_join(thread, NULL);
+
+    result->sent    = generator.sent;
+    result->seconds = (result->received > 0) ? (result->stop - generator.start) / 1e9 : 0;
+
+    status = 0;
+  }
+  else if(generator.fd != -1) close(generator.fd);
+
+  for(int index = 0; index < 3; index++) procom_stop(pids[index]);
+
+  if(collect_fd != -1) close(collect_fd);
+
+  close(hold_pipe[0]);
+
+  close(hold_pipe[1]);
+
+  if(topology->fifo)
+  {
+    unlink(in_path);
+
+    unlink(out_path);
+  }
+
+  return status;
+}
+
+static int latency_compare(const void* a, const void* b)
+{
+  long first = *(const long*) a, second = *(const long*) b;
+
+  return (first > second) - (first < second);
+}
+
+/*
+ * Get a percentile of the sorted latencies, in microseconds
+ */
+static double latency_percentile(const long* latencies, size_t count, double percentile)
+{
+  if(count == 0) return 0;
+
+  return latencies[(size_t) ((count - 1) * percentile)] / 1e3;
+}
+
+/*
+ * Print the result of one topology as a JSON object
+ */
+static void result_print(const struct topology* topology, struct result* result, int status, bool first)
+{
+  qsort(result->latencies, result->received, sizeof(long), latency_compare);
+
+  double seconds = (result->seconds > 0) ? result->seconds : 1;
+
+  printf("%s\n    {\n", first ? "" : ",");
+
+  printf("      \"topology\": \"%s\",\n", topology->name);
+
+  printf("      \"status\": \"%s\",\n", (status == 0) ? ((result->received == result->sent) ? "ok" : "lost") : "failed");
+
+  printf("      \"sent\": %zu,\n", result->sent);
+
+  printf("      \"received\": %zu,\n", result->received);
+
+  printf("      \"seconds\": %.6f,\n", result->seconds);
+
+  printf("      \"msgs_per_sec\": %.1f,\n", result->received / seconds);
+
+  printf("      \"mb_per_sec\": %.3f,\n", result->bytes / seconds / 1e6);
+
+  printf("      \"latency_us\": { \"p50\": %.3f, \"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f }\n",
+    latency_percentile(result->latencies, result->received, 0.50),
+    latency_percentile(result->latencies, result->received, 0.99),
+    latency_percentile(result->latencies, result->received, 0.999),
+    latency_percentile(result->latencies, result->received, 1.0));
+
+  printf("    }");
+}
+
+/*
+ * Run procom pairs over every topology, and print the results as JSON
+ */
+int main(int argc, char* argv[])
+{
+  argp_parse(&argp, argc, argv, 0, 0, &args);
+
+  if(args.list)
+  {
+    for(size_t index = 0; index < TOPOLOGY_COUNT; index++) printf("%s\n", topologies[index].name);
+
+    return 0;
+  }
+
+  // By default, procom is next to procom-bench
+  char procom[4096];
+
+  if(!args.procom)
+  {
+    snprintf(procom, sizeof(procom), "%s/procom", dirname(strdup(argv[0])));
+
+    args.procom = procom;
+  }
+
+  // The generator notices that the sender has stopped when its writes fail
+  signal(SIGPIPE, SIG_IGN);
+
+  printf("{\n  \"count\": %zu,\n  \"size_min\": %zu,\n  \"size_max\": %zu,\n  \"rate\": %.1f,\n  \"results\": [",
+    args.count, args.size_min, args.size_max, args.rate);
+
+  int status = 0;
+
+  bool first = true;
+
+  for(size_t index = 0; index < TOPOLOGY_COUNT; index++)
+  {
+    const struct topology* topology = &topologies[index];
+
+    if(args.topology && !strstr(topology->name, args.topology)) continue;
+
+    struct result result = { .latencies = malloc(sizeof(long) * args.count) };
+
+    int run_status = topology_run(topology, &result);
+
+    if(run_status != 0 || result.received != result.sent) status = 1;
+
+    result_print(topology, &result, run_status, first);
+
+    fflush(stdout);
+
+    free(result.latencies);
+
+    first = false;
+  }
+
+  printf("\n  ]\n}\n");
+
+  return status;
+}
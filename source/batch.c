@@ -0,0 +1,218 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#define _GNU_SOURCE
+
+#include "batch.h"
+
+/*
+ * Parse a batching policy of the form BYTES:LINES:USEC
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | The policy is malformed
+ */
+int batch_spec_parse(const char* spec, size_t* bytes, size_t* lines, long* window)
+{
+  int length = 0;
+
+  if(strchr(spec, '-')) return -1;
+
+  if(sscanf(spec, "%zu:%zu:%ld%n", bytes, lines, window, &length) != 3) return -1;
+
+  if(spec[length] != '\0') return -1;
+
+  return 0;
+}
+
+/*
+ * Initialize batching window, with its limits
+ *
+ * PARAMS
+ * - size_t bytes | Bytes that are sent as soon as they are pending, or 0
+ * - size_t lines | Lines that are sent as soon as they are pending, or 0
+ * - long window  | Microseconds to wait for more lines, or 0
+ */
+void batch_init(struct batch* batch, size_t bytes, size_t lines, long window)
+{
+  batch->bytes      = bytes;
+  batch->lines      = lines;
+  batch->window     = window;
+  batch->start      = 0;
+  batch->busy       = false;
+  batch->sent       = 0;
+  batch->batches    = 0;
+  batch->sent_bytes = 0;
+  batch->sent_lines = 0;
+  batch->timeouts   = 0;
+}
+
+/*
+ * Get the monotonic time, in microseconds
+ */
+static long batch_time(void)
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+
+  return time.tv_sec * 1000000L + time.tv_nsec / 1000;
+}
+
+/*
+ * Check if the batch has reached one of its limits, or fills the send buffer
+ */
+static bool batch_full(const struct batch* batch, const struct writer* writer)
+{
+  if(writer->end == writer->size) return true;
+
+  if(batch->bytes && writer->end - writer->start >= batch->bytes) return true;
+
+  if(batch->lines && writer->pending >= batch->lines) return true;
+
+  return false;
+}
+
+/*
+ * Read the next chunk of lines for the batch, without going over its limits
+ * or the free space of the send buffer
+ *
+ * Without a policy, the chunk is left for the writer to send however it sees fit,
+ * which includes sending large chunks without copying them
+ *
+ * RETURN (same as reader_lines_read)
+ */
+ssize_t batch_lines_read(const struct batch* batch, struct reader* reader, const struct writer* writer, const char** lines)
+{
+  if(!batch->bytes && !batch->lines && !batch->window) return reader_lines_read(reader, lines, reader->size);
+
+  // Keep the batch in the send buffer, so that it is sent in one piece
+  size_t room = writer->size - writer->end;
+
+  size_t pending = writer->end - writer->start;
+
+  if(batch->bytes && batch->bytes - pending < room) room = batch->bytes - pending;
+
+  size_t count = batch->lines ? batch->lines - writer->pending : 0;
+
+  return reader_lines_count_read(reader, lines, room, count);
+}
+
+/*
+ * Wait for the reader's endpoint to become readable, for at most timeout microseconds
+ *
+ * RETURN (int status)
+ * -  1 | The endpoint is readable
+ * -  0 | The timeout passed
+ * - -1 | Failed to wait, or interrupted
+ */
+static int batch_wait(int fd, long timeout)
+{
+  struct pollfd pollfd = { .fd = fd, .events = POLLIN };
+
+  struct timespec time = { .tv_sec = timeout / 1000000L, .tv_nsec = (timeout % 1000000L) * 1000 };
+
+  int status = ppoll(&pollfd, 1, &time, NULL);
+
+  if(status == -1) return -1;
+
+  return (status > 0) ? 1 : 0;
+}
+
+/*
+ * Send the pending lines of the batch right away
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to write to endpoint
+ */
+int batch_send(struct batch* batch, struct writer* writer)
+{
+  size_t bytes = writer->end - writer->start;
+
+  size_t lines = writer->pending;
+
+  batch->start = 0;
+
+  if(bytes == 0) return 0;
+
+  if(writer_flush(writer) == -1) return -1;
+
+  batch->batches++;
+
+  batch->sent_bytes += bytes;
+  batch->sent_lines += lines;
+
+  // Lines are queueing up if they didn't get a batch of their own
+  batch->busy = (lines > 1);
+
+  if(batch->window > 0) batch->sent = batch_time();
+
+  return 0;
+}
+
+/*
+ * Send the pending lines, if the batch is full, or if the reader has run dry
+ * and the window has passed. Else, the caller should keep reading lines
+ *
+ * Note: This might wait for the reader, for at most the rest of the window
+ *
+ * RETURN (int status)
+ * -  0 | Success, the lines are either sent or still collected
+ * - -1 | Failed to write to endpoint, or interrupted
+ */
+int batch_flush(struct batch* batch, const struct reader* reader, struct writer* writer)
+{
+  // The pending lines might already have been sent, if they filled the send buffer
+  if(!writer_pending(writer))
+  {
+    batch->start = 0;
+
+    return 0;
+  }
+
+  if(batch_full(batch, writer)) return batch_send(batch, writer);
+
+  // The next read will not block, so keep collecting lines
+  if(reader_line_pending(reader)) return 0;
+
+  if(batch->window > 0)
+  {
+    long now = batch_time();
+
+    if(batch->start == 0) batch->start = now;
+
+    // An idle link sends right away, the window is only waited for while lines
+    // are queueing up, or are arriving within a window of the last batch
+    bool busy = batch->busy || (batch->sent > 0 && batch->start - batch->sent < batch->window);
+
+    if(busy)
+    {
+      long remaining = batch->window - (now - batch->start);
+
+      int status = (remaining > 0) ? batch_wait(reader->fd, remaining) : 0;
+
+      if(status == -1) return -1;
+
+      if(status == 1) return 0; // More lines have arrived
+
+      batch->timeouts++;
+    }
+  }
+
+  return batch_send(batch, writer);
+}
+
+/*
+ * Print the average size of the batches, and how often the window ran out
+ */
+void batch_report(const struct batch* batch, const char* name)
+{
+  size_t batches = batch->batches ? batch->batches : 1;
+
+  log_print(stderr, "BATCH", "%s sent %zu batches of %.1f lines (%.1f bytes) on average, %zu windows ran out", name,
+    batch->batches, (double) batch->sent_lines / batches, (double) batch->sent_bytes / batches, batch->timeouts);
+}
@@ -0,0 +1,60 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "debug.h"
+#include "reader.h"
+#include "writer.h"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+
+/*
+ * Batching window of a writer
+ *
+ * The pending lines are sent once the batch holds bytes bytes or lines lines,
+ * or once the reader has run dry and window microseconds have passed
+ *
+ * The window is only waited for while the link is busy, meaning that the last batch
+ * held more than one line, or that the lines arrive within a window of the last batch,
+ * so that an idle link sends right away
+ *
+ * A limit of 0 means no limit, and a window of 0 sends as soon as the reader runs dry
+ */
+struct batch
+{
+  size_t bytes;
+  size_t lines;
+  long   window;
+  long   start;
+  long   sent;
+  bool   busy;
+  size_t batches;
+  size_t sent_bytes;
+  size_t sent_lines;
+  size_t timeouts;
+};
+
+extern int     batch_spec_parse(const char* spec, size_t* bytes, size_t* lines, long* window);
+
+extern void    batch_init(struct batch* batch, size_t bytes, size_t lines, long window);
+
+extern ssize_t batch_lines_read(const struct batch* batch, struct reader* reader, const struct writer* writer, const char** lines);
+
+extern int     batch_flush(struct batch* batch, const struct reader* reader, struct writer* writer);
+
+extern int     batch_send(struct batch* batch, struct writer* writer);
+
+extern void    batch_report(const struct batch* batch, const char* name);
+
+#endif // BATCH_H
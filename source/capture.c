@@ -0,0 +1,386 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#include "capture.h"
+
+/*
+ * The capture file that the forwarded messages are appended to
+ *
+ * A window of the file is mapped at a time, and the messages are copied into it.
+ * When the window is full, the file is extended and the next window is mapped
+ */
+static struct
+{
+  pthread_mutex_t lock;
+  int             fd;
+  char*           window;
+  off_t           offset; // The offset of the window in the file
+  size_t          used;   // The number of used bytes in the window
+  size_t          records;
+  bool            failed;
+} capture = { .lock = PTHREAD_MUTEX_INITIALIZER, .fd = -1 };
+
+/*
+ * The capture file that is played back, through a reader
+ */
+static struct
+{
+  char*  map;
+  size_t size;
+  size_t offset;    // The offset of the next record
+  size_t remaining; // The bytes left of the current record
+  int    direction;
+  bool   fast;
+  long   first;     // The time of the first record
+  long   start;     // The monotonic time that the playback started
+  size_t records;
+} play = { .map = NULL };
+
+/*
+ * Get the time of a clock, in nanoseconds
+ */
+static long clock_time(clockid_t clock)
+{
+  struct timespec time;
+
+  clock_gettime(clock, &time);
+
+  return time.tv_sec * 1000000000L + time.tv_nsec;
+}
+
+/*
+ * Map the window of the capture file at offset, extending the file to fit it
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to extend the file or to map the window
+ */
+static int capture_window_map(off_t offset)
+{
+  if(ftruncate(capture.fd, offset + CAPTURE_WINDOW) == -1) return -1;
+
+  char* window = mmap(NULL, CAPTURE_WINDOW, PROT_READ | PROT_WRITE, MAP_SHARED, capture.fd, offset);
+
+  if(window == MAP_FAILED) return -1;
+
+  capture.window = window;
+  capture.offset = offset;
+  capture.used   = 0;
+
+  return 0;
+}
+
+/*
+ * Append bytes to the capture file, moving on to the next window when the window is full
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to map the next window
+ */
+static int capture_append(const void* bytes, size_t length)
+{
+  while(length > 0)
+  {
+    if(capture.used == CAPTURE_WINDOW)
+    {
+      munmap(capture.window, CAPTURE_WINDOW);
+
+      capture.window = NULL;
+
+      if(capture_window_map(capture.offset + CAPTURE_WINDOW) == -1) return -1;
+    }
+
+    size_t size = CAPTURE_WINDOW - capture.used;
+
+    if(size > length) size = length;
+
+    memcpy(capture.window + capture.used, bytes, size);
+
+    capture.used += size;
+
+    bytes   = (const char*) bytes + size;
+    length -= size;
+  }
+
+  return 0;
+}
+
+/*
+ * Create the capture file, and write its header
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to create or map the capture file
+ */
+int capture_create(const char* path, bool debug)
+{
+  capture.fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if(capture.fd == -1)
+  {
+    if(debug) error_print("Failed to create capture file %s: %s", path, strerror(errno));
+
+    return -1;
+  }
+
+  struct capture_header header = { .magic = CAPTURE_MAGIC, .version = CAPTURE_VERSION };
+
+  if(capture_window_map(0) == -1 || capture_append(&header, sizeof(header)) == -1)
+  {
+    if(debug) error_print("Failed to map capture file %s: %s", path, strerror(errno));
+
+    close(capture.fd);
+
+    capture.fd = -1;
+
+    return -1;
+  }
+
+  capture.records = 0;
+  capture.failed  = false;
+
+  if(debug) info_print("Capturing to %s", path);
+
+  return 0;
+}
+
+/*
+ * Close the capture file, cutting it to the captured bytes
+ */
+void capture_close(bool debug)
+{
+  if(capture.fd == -1) return;
+
+  off_t length = capture.offset + capture.used;
+
+  if(capture.window) munmap(capture.window, CAPTURE_WINDOW);
+
+  capture.window = NULL;
+
+  if(ftruncate(capture.fd, length) == -1 && debug)
+  {
+    error_print("Failed to cut capture file: %s", strerror(errno));
+  }
+
+  close(capture.fd);
+
+  capture.fd = -1;
+
+  if(debug) info_print("Captured %ld records (%ld bytes)", (long) capture.records, (long) length);
+}
+
+/*
+ * Append a message to the capture file, with its time, direction and length
+ *
+ * If the capture file can't be extended, capturing stops, but the relay goes on
+ */
+void capture_record(int direction, const char* bytes, size_t length)
+{
+  struct capture_record record =
+  {
+    .time      = clock_time(CLOCK_REALTIME),
+    .length    = length,
+    .direction = direction
+  };
+
+  int saved_errno = errno;
+
+  pthread_mutex_lock(&capture.lock);
+
+  if(capture.fd != -1 && !capture.failed)
+  {
+    if(capture_append(&record, sizeof(record)) == -1 || capture_append(bytes, length) == -1)
+    {
+      error_print("Failed to capture, capturing stopped: %s", strerror(errno));
+
+      capture.failed = true;
+    }
+    else capture.records++;
+  }
+
+  pthread_mutex_unlock(&capture.lock);
+
+  errno = saved_errno;
+}
+
+/*
+ * Open a capture file to play back the messages of one direction
+ *
+ * PARAMS
+ * - int direction | The direction of the messages to play back
+ * - bool fast     | Play back as fast as possible, instead of at the original pacing
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to open the capture file, or it isn't a capture file
+ */
+int capture_play_open(const char* path, int direction, bool fast, bool debug)
+{
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+  if(fd == -1)
+  {
+    if(debug) error_print("Failed to open capture file %s: %s", path, strerror(errno));
+
+    return -1;
+  }
+
+  struct stat stat;
+
+  if(fstat(fd, &stat) == -1 || (size_t) stat.st_size < sizeof(struct capture_header))
+  {
+    if(debug) error_print("Capture file %s is too short", path);
+
+    close(fd);
+
+    return -1;
+  }
+
+  char* map = mmap(NULL, stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  close(fd);
+
+  if(map == MAP_FAILED)
+  {
+    if(debug) error_print("Failed to map capture file %s: %s", path, strerror(errno));
+
+    return -1;
+  }
+
+  struct capture_header header;
+
+  memcpy(&header, map, sizeof(header));
+
+  if(memcmp(header.magic, CAPTURE_MAGIC, sizeof(header.magic)) != 0 || header.version != CAPTURE_VERSION)
+  {
+    if(debug) error_print("%s is not a capture file", path);
+
+    munmap(map, stat.st_size);
+
+    return -1;
+  }
+
+  madvise(map, stat.st_size, MADV_SEQUENTIAL);
+
+  play.map       = map;
+  play.size      = stat.st_size;
+  play.offset    = sizeof(header);
+  play.remaining = 0;
+  play.direction = direction;
+  play.fast      = fast;
+  play.first     = -1;
+  play.records   = 0;
+
+  if(debug) info_print("Playing back %s", path);
+
+  return 0;
+}
+
+/*
+ * Close the capture file that was played back
+ */
+void capture_play_close(bool debug)
+{
+  if(!play.map) return;
+
+  if(debug) info_print("Played back %ld records", (long) play.records);
+
+  munmap(play.map, play.size);
+
+  play.map = NULL;
+}
+
+/*
+ * Find the next record of the played back direction
+ *
+ * RETURN (struct capture_record* record)
+ * - !NULL | Success!
+ * -  NULL | End of the capture file
+ */
+static const struct capture_record* capture_play_next(void)
+{
+  while(play.offset + sizeof(struct capture_record) <= play.size)
+  {
+    const struct capture_record* record = (const struct capture_record*) (play.map + play.offset);
+
+    play.offset += sizeof(struct capture_record);
+
+    // A record cut by a crash ends the playback
+    if(play.offset + record->length > play.size) break;
+
+    if(record->direction == play.direction) return record;
+
+    play.offset += record->length;
+  }
+
+  play.offset = play.size;
+
+  return NULL;
+}
+
+/*
+ * Read the played back messages, waiting until each is due
+ *
+ * This is the fill function of a reader, the fd is not used
+ *
+ * RETURN (ssize_t size)
+ * - >0 | The number of read bytes
+ * -  0 | End of the capture file
+ * - -1 | Interrupted while waiting
+ */
+ssize_t capture_play_read(int fd, char* buffer, size_t size)
+{
+  if(errno != 0) return -1;
+
+  if(!buffer || !play.map) return 0;
+
+  if(play.remaining == 0)
+  {
+    const struct capture_record* record = capture_play_next();
+
+    if(!record) return 0;
+
+    if(play.first == -1)
+    {
+      play.first = record->time;
+
+      play.start = clock_time(CLOCK_MONOTONIC);
+    }
+
+    long due = play.start + (long) (record->time - play.first);
+
+    // Wait until the record is due, relative to the first record
+    if(!play.fast && due > clock_time(CLOCK_MONOTONIC))
+    {
+      struct timespec until = { .tv_sec = due / 1000000000L, .tv_nsec = due % 1000000000L };
+
+      int status = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL);
+
+      if(status != 0)
+      {
+        // Wait for the record again, on the next read
+        play.offset -= sizeof(struct capture_record);
+
+        errno = status;
+
+        return -1;
+      }
+    }
+
+    play.remaining = record->length;
+
+    play.records++;
+  }
+
+  size_t length = (play.remaining < size) ? play.remaining : size;
+
+  memcpy(buffer, play.map + play.offset, length);
+
+  play.offset    += length;
+  play.remaining -= length;
+
+  return length;
+}
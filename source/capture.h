@@ -0,0 +1,63 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "debug.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CAPTURE_MAGIC   "PROCOMCP"
+#define CAPTURE_VERSION 1
+#define CAPTURE_WINDOW  4194304 // Bytes of the file that are mapped at a time
+
+#define CAPTURE_STDIN   0 // Lines forwarded by the stdin routine
+#define CAPTURE_STDOUT  1 // Lines forwarded by the stdout routine
+
+/*
+ * The capture file starts with a header, followed by records,
+ * which are a record header followed by the bytes of the message
+ *
+ * The integers are stored in the byte order of the host
+ */
+struct capture_header
+{
+  char     magic[8];
+  uint32_t version;
+  uint32_t reserved;
+};
+
+struct capture_record
+{
+  uint64_t time;      // Nanoseconds since the epoch
+  uint32_t length;
+  uint16_t direction;
+  uint16_t reserved;
+};
+
+extern int     capture_create(const char* path, bool debug);
+
+extern void    capture_close(bool debug);
+
+extern void    capture_record(int direction, const char* bytes, size_t length);
+
+extern int     capture_play_open(const char* path, int direction, bool fast, bool debug);
+
+extern void    capture_play_close(bool debug);
+
+extern ssize_t capture_play_read(int fd, char* buffer, size_t size);
+
+#endif // CAPTURE_H
@@ -0,0 +1,420 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#include "compress.h"
+
+/*
+ * The compressed link of the process
+ *
+ * When the peers connect, they exchange hellos with the codecs they support,
+ * and use the best codec that both of them support
+ *
+ * Every batch of bytes from the writer is sent as a frame:
+ * - the length of the batch  (4 bytes, big endian)
+ * - the length of the block  (4 bytes, big endian)
+ * - the block, which is the batch compressed with the codec,
+ *   or the batch itself if the codec couldn't make it smaller
+ *
+ * The stdin thread sends frames and the stdout thread receives frames,
+ * so each direction has its own buffers and statistics
+ */
+static struct
+{
+  int     sockfd;
+  int     codec;
+
+  // The sending direction, used by compress_write
+  char*   send_block;
+  size_t  send_frames;
+  size_t  send_bytes;
+  size_t  send_wire;
+  double  send_cpu;
+
+  // The receiving direction, used by compress_read
+  char*   recv_block;
+  char*   recv_batch;
+  size_t  recv_start;
+  size_t  recv_end;
+  size_t  recv_frames;
+  size_t  recv_bytes;
+  size_t  recv_wire;
+  double  recv_cpu;
+} compress = { .sockfd = -1 };
+
+#define COMPRESS_MAGIC        "PCOM"
+#define COMPRESS_VERSION      1
+#define COMPRESS_HELLO_SIZE   8
+#define COMPRESS_HEADER_SIZE  (2 * FRAME_HEADER_SIZE)
+#define COMPRESS_BLOCK_BOUND  LZ4_BOUND(COMPRESS_BLOCK_SIZE)
+
+// The codecs that this build supports, as a mask
+#define COMPRESS_CODECS COMPRESS_LZ4
+
+/*
+ * Get the cpu time of the calling thread, in seconds
+ */
+static double thread_cpu_time(void)
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/*
+ * Send all bytes, continuing partial sends
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to send bytes
+ */
+static int bytes_send(int sockfd, const char* bytes, size_t length)
+{
+  while(length > 0)
+  {
+    ssize_t status = send(sockfd, bytes, length, MSG_NOSIGNAL);
+
+    if(status == -1) return -1;
+
+    bytes  += status;
+    length -= status;
+  }
+
+  return 0;
+}
+
+/*
+ * Receive exactly length bytes, continuing partial receives
+ *
+ * RETURN (int status)
+ * -  1 | Success
+ * -  0 | End of file, before the first byte
+ * - -1 | Failed to receive bytes, or end of file within the bytes
+ */
+static int bytes_recv(int sockfd, char* bytes, size_t length)
+{
+  for(size_t index = 0; index < length;)
+  {
+    ssize_t status = recv(sockfd, bytes + index, length - index, 0);
+
+    if(status == -1) return -1;
+
+    if(status == 0)
+    {
+      if(index == 0) return 0;
+
+      errno = EPROTO;
+
+      return -1;
+    }
+
+    index += status;
+  }
+
+  return 1;
+}
+
+/*
+ * Exchange hellos with the peer, agreeing on a codec
+ *
+ * The hello is the magic, the version and the mask of supported codecs
+ *
+ * RETURN (int codec)
+ * - >=0 | Success! The agreed codec
+ * -  -1 | Failed to exchange hellos, or the peer doesn't compress
+ */
+static int compress_hello(int sockfd, bool debug)
+{
+  char hello[COMPRESS_HELLO_SIZE] = COMPRESS_MAGIC;
+
+  hello[4] = COMPRESS_VERSION;
+  hello[5] = COMPRESS_CODECS;
+
+  if(bytes_send(sockfd, hello, COMPRESS_HELLO_SIZE) == -1)
+  {
+    if(debug) error_print("Failed to send hello: %s", strerror(errno));
+
+    return -1;
+  }
+
+  // A peer without compression never sends a hello
+  struct pollfd pollfd = { .fd = sockfd, .events = POLLIN };
+
+  int status = poll(&pollfd, 1, COMPRESS_TIMEOUT);
+
+  if(status <= 0)
+  {
+    if(debug) error_print("Peer didn't send hello, is it compressing?");
+
+    return -1;
+  }
+
+  char peer[COMPRESS_HELLO_SIZE];
+
+  if(bytes_recv(sockfd, peer, COMPRESS_HELLO_SIZE) != 1)
+  {
+    if(debug) error_print("Failed to receive hello");
+
+    return -1;
+  }
+
+  if(memcmp(peer, COMPRESS_MAGIC, 4) != 0 || peer[4] != COMPRESS_VERSION)
+  {
+    if(debug) error_print("Peer sent a malformed hello");
+
+    return -1;
+  }
+
+  int codecs = peer[5] & COMPRESS_CODECS;
+
+  return (codecs & COMPRESS_LZ4) ? COMPRESS_LZ4 : COMPRESS_NONE;
+}
+
+/*
+ * Negotiate compression with the peer, and allocate the frame buffers
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to negotiate or to allocate the buffers
+ */
+int compress_create(int sockfd, bool debug)
+{
+  int codec = compress_hello(sockfd, debug);
+
+  if(codec == -1) return -1;
+
+  compress.send_block = pool_alloc(COMPRESS_BLOCK_BOUND);
+  compress.recv_block = pool_alloc(COMPRESS_BLOCK_BOUND);
+  compress.recv_batch = pool_alloc(COMPRESS_BLOCK_SIZE);
+
+  if(!compress.send_block || !compress.recv_block || !compress.recv_batch)
+  {
+    if(debug) error_print("Failed to allocate compression buffers");
+
+    compress_free(false);
+
+    return -1;
+  }
+
+  compress.sockfd = sockfd;
+  compress.codec  = codec;
+
+  if(debug) info_print("Compression: %s", (codec == COMPRESS_LZ4) ? "lz4" : "none");
+
+  return 0;
+}
+
+/*
+ * Print the compression ratio and the cpu time of one direction
+ */
+static void compress_stats_print(const char* name, size_t frames, size_t bytes, size_t wire, double cpu)
+{
+  if(frames == 0) return;
+
+  info_print("Compression %s: %ld frames, %ld bytes as %ld bytes (ratio %f), %f ms cpu",
+    name, (long) frames, (long) bytes, (long) wire, (double) bytes / wire, cpu * 1e3);
+}
+
+/*
+ * Free the frame buffers, reporting the compression of both directions
+ */
+void compress_free(bool debug)
+{
+  if(debug)
+  {
+    compress_stats_print("sent", compress.send_frames, compress.send_bytes, compress.send_wire, compress.send_cpu);
+
+    compress_stats_print("received", compress.recv_frames, compress.recv_bytes, compress.recv_wire, compress.recv_cpu);
+  }
+
+  pool_release(compress.send_block);
+  pool_release(compress.recv_block);
+  pool_release(compress.recv_batch);
+
+  compress.send_block = NULL;
+  compress.recv_block = NULL;
+  compress.recv_batch = NULL;
+
+  compress.sockfd = -1;
+}
+
+/*
+ * Compress a batch of bytes and send it as a frame
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to send frame
+ */
+static int frame_send(int sockfd, const char* batch, size_t length)
+{
+  char* block = compress.send_block + COMPRESS_HEADER_SIZE;
+
+  size_t block_length = 0;
+
+  if(compress.codec == COMPRESS_LZ4)
+  {
+    double start = thread_cpu_time();
+
+    block_length = lz4_compress(batch, length, block, COMPRESS_BLOCK_BOUND - COMPRESS_HEADER_SIZE);
+
+    compress.send_cpu += thread_cpu_time() - start;
+  }
+
+  // The batch is sent as it is, if it couldn't be made smaller
+  if(block_length == 0 || block_length >= length)
+  {
+    memcpy(block, batch, length);
+
+    block_length = length;
+  }
+
+  frame_header_encode(compress.send_block, length);
+
+  frame_header_encode(compress.send_block + FRAME_HEADER_SIZE, block_length);
+
+  if(bytes_send(sockfd, compress.send_block, COMPRESS_HEADER_SIZE + block_length) == -1) return -1;
+
+  compress.send_frames++;
+  compress.send_bytes += length;
+  compress.send_wire  += COMPRESS_HEADER_SIZE + block_length;
+
+  return 0;
+}
+
+/*
+ * Write iovecs to the socket as compressed frames
+ *
+ * This is the flush function of a writer, every batch is sent
+ * as one frame, or as several frames if it is larger than a block
+ *
+ * RETURN (ssize_t size)
+ * - >0 | The number of written bytes, before compression
+ * -  0 | Nothing to write to, end of file
+ * - -1 | Failed to write to socket
+ */
+ssize_t compress_write(int sockfd, const struct iovec* iovecs, int count)
+{
+  if(errno != 0) return -1;
+
+  if(!iovecs) return 0;
+
+  ssize_t total = 0;
+
+  for(int index = 0; index < count; index++)
+  {
+    const char* bytes = iovecs[index].iov_base;
+
+    size_t length = iovecs[index].iov_len;
+
+    for(size_t offset = 0; offset < length; offset += COMPRESS_BLOCK_SIZE)
+    {
+      size_t size = length - offset;
+
+      if(size > COMPRESS_BLOCK_SIZE) size = COMPRESS_BLOCK_SIZE;
+
+      if(frame_send(sockfd, bytes + offset, size) == -1) return -1;
+    }
+
+    total += length;
+  }
+
+  return total;
+}
+
+/*
+ * Receive the next frame and decompress it into the batch buffer
+ *
+ * RETURN (int status)
+ * -  1 | Success
+ * -  0 | End of file
+ * - -1 | Failed to receive frame, or the frame is malformed
+ */
+static int frame_recv(int sockfd)
+{
+  char header[COMPRESS_HEADER_SIZE];
+
+  int status = bytes_recv(sockfd, header, COMPRESS_HEADER_SIZE);
+
+  if(status != 1) return status;
+
+  uint32_t length = frame_header_decode(header);
+
+  uint32_t block_length = frame_header_decode(header + FRAME_HEADER_SIZE);
+
+  if(length == 0 || length > COMPRESS_BLOCK_SIZE || block_length > length)
+  {
+    errno = EPROTO;
+
+    return -1;
+  }
+
+  // The batch was sent as it is, receive it directly into the batch buffer
+  if(block_length == length)
+  {
+    if(bytes_recv(sockfd, compress.recv_batch, length) != 1) return -1;
+  }
+  else
+  {
+    if(bytes_recv(sockfd, compress.recv_block, block_length) != 1) return -1;
+
+    double start = thread_cpu_time();
+
+    ssize_t size = lz4_decompress(compress.recv_block, block_length, compress.recv_batch, length);
+
+    compress.recv_cpu += thread_cpu_time() - start;
+
+    if(size != (ssize_t) length)
+    {
+      errno = EPROTO;
+
+      return -1;
+    }
+  }
+
+  compress.recv_start = 0;
+  compress.recv_end   = length;
+
+  compress.recv_frames++;
+  compress.recv_bytes += length;
+  compress.recv_wire  += COMPRESS_HEADER_SIZE + block_length;
+
+  return 1;
+}
+
+/*
+ * Read decompressed bytes from the socket
+ *
+ * This is the fill function of a reader
+ *
+ * RETURN (ssize_t size)
+ * - >0 | The number of read bytes
+ * -  0 | End of file
+ * - -1 | Failed to read from socket
+ */
+ssize_t compress_read(int sockfd, char* buffer, size_t size)
+{
+  if(errno != 0) return -1;
+
+  if(!buffer) return 0;
+
+  if(compress.recv_start == compress.recv_end)
+  {
+    int status = frame_recv(sockfd);
+
+    if(status != 1) return status;
+  }
+
+  size_t length = compress.recv_end - compress.recv_start;
+
+  if(length > size) length = size;
+
+  memcpy(buffer, compress.recv_batch + compress.recv_start, length);
+
+  compress.recv_start += length;
+
+  return length;
+}
@@ -0,0 +1,38 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include "debug.h"
+#include "frame.h"
+#include "pool.h"
+#include "lz4.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#define COMPRESS_BLOCK_SIZE 65536 // The largest batch of bytes in one frame
+#define COMPRESS_TIMEOUT    5000  // Milliseconds to wait for the peer's hello
+
+#define COMPRESS_NONE 0x00
+#define COMPRESS_LZ4  0x01
+
+extern int     compress_create(int sockfd, bool debug);
+
+extern void    compress_free(bool debug);
+
+extern ssize_t compress_read(int sockfd, char* buffer, size_t size);
+
+extern ssize_t compress_write(int sockfd, const struct iovec* iovecs, int count);
+
+#endif // COMPRESS_H
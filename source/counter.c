@@ -0,0 +1,179 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#include "counter.h"
+
+static struct direction directions[COUNTER_DIRECTIONS];
+
+static size_t direction_count = 0;
+
+static const char* hop_names[HOP_COUNT] = { "read", "frame", "write" };
+
+// The hop histograms are merged into static buffers, which the printing threads share
+static pthread_mutex_t print_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Create the counters of a new direction
+ *
+ * RETURN (struct direction* direction)
+ * - !NULL | Success!
+ * -  NULL | There is no room for more directions
+ */
+struct direction* direction_create(const char* name)
+{
+  size_t index = __atomic_load_n(&direction_count, __ATOMIC_RELAXED);
+
+  do
+  {
+    if(index >= COUNTER_DIRECTIONS) return NULL;
+  }
+  while(!__atomic_compare_exchange_n(&direction_count, &index, index + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+  struct direction* direction = &directions[index];
+
+  snprintf(direction->name, sizeof(direction->name), "%s", name);
+
+  return direction;
+}
+
+/*
+ * Print the counters of one side of a direction
+ */
+static void counters_print(const char* name, const char* side, const struct counters* counters)
+{
+  log_print(stderr, "COUNTERS", "%s %s %ld lines, %ld bytes, %ld syscalls, %ld partial, %ld eagain, %ld errors",
+    name, side,
+    (long) __atomic_load_n(&counters->lines,    __ATOMIC_RELAXED),
+    (long) __atomic_load_n(&counters->bytes,    __ATOMIC_RELAXED),
+    (long) __atomic_load_n(&counters->syscalls, __ATOMIC_RELAXED),
+    (long) __atomic_load_n(&counters->partials, __ATOMIC_RELAXED),
+    (long) __atomic_load_n(&counters->eagains,  __ATOMIC_RELAXED),
+    (long) __atomic_load_n(&counters->errors,   __ATOMIC_RELAXED));
+}
+
+/*
+ * Print the percentiles of every hop of the timed directions,
+ * and of every hop merged over all of them
+ *
+ * Note: The caller has to hold the print lock
+ */
+static void directions_hops_print(size_t count)
+{
+  static struct histogram snapshot, totals[HOP_COUNT];
+
+  memset(totals, 0, sizeof(totals));
+
+  char name[COUNTER_NAME_SIZE + 16];
+
+  for(size_t index = 0; index < count; index++)
+  {
+    if(!directions[index].timed) continue;
+
+    for(int hop = 0; hop < HOP_COUNT; hop++)
+    {
+      memset(&snapshot, 0, sizeof(snapshot));
+
+      histogram_merge(&snapshot, &directions[index].hops[hop]);
+
+      snprintf(name, sizeof(name), "%s %s", directions[index].name, hop_names[hop]);
+
+      histogram_print(name, &snapshot);
+
+      histogram_merge(&totals[hop], &snapshot);
+    }
+  }
+
+  for(int hop = 0; hop < HOP_COUNT; hop++)
+  {
+    snprintf(name, sizeof(name), "all directions %s", hop_names[hop]);
+
+    histogram_print(name, &totals[hop]);
+  }
+}
+
+/*
+ * Print the counters and the hop latencies of every direction to stderr,
+ * which is safe to do while the directions are relaying
+ *
+ * Threads that print at the same time, like main at exit and the SIGUSR2 thread,
+ * take turns, so that their reports don't mix
+ */
+void directions_print(void)
+{
+  pthread_mutex_lock(&print_lock);
+
+  size_t count = __atomic_load_n(&direction_count, __ATOMIC_ACQUIRE);
+
+  for(size_t index = 0; index < count; index++)
+  {
+    counters_print(directions[index].name, "read",  &directions[index].read);
+
+    counters_print(directions[index].name, "wrote", &directions[index].write);
+  }
+
+  directions_hops_print(count);
+
+  pthread_mutex_unlock(&print_lock);
+}
+
+/*
+ * Wait for SIGUSR2, and print the counters every time it arrives
+ */
+static void* directions_dump_routine(void* arg)
+{
+  sigset_t sigset;
+
+  sigemptyset(&sigset);
+
+  sigaddset(&sigset, SIGUSR2);
+
+  int signum;
+
+  while(sigwait(&sigset, &signum) == 0) directions_print();
+
+  return NULL;
+}
+
+/*
+ * Start the thread that prints the counters on SIGUSR2
+ *
+ * SIGUSR2 is blocked in the calling thread, and in every thread created after it,
+ * so the signal never interrupts the syscalls of the relays
+ *
+ * Note: This has to be called before any other thread is created
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to start thread
+ */
+int directions_dump_start(bool debug)
+{
+  sigset_t sigset;
+
+  sigemptyset(&sigset);
+
+  sigaddset(&sigset, SIGUSR2);
+
+  if(pthread_sigmask(SIG_BLOCK, &sigset, NULL) != 0)
+  {
+    if(debug) error_print("Failed to block SIGUSR2");
+
+    return -1;
+  }
+
+  pthread_t thread;
+
+  if(pthread_create(&thread, NULL, directions_dump_routine, NULL) != 0)
+  {
+    if(debug) error_print("Failed to start counters thread");
+
+    return -1;
+  }
+
+  pthread_detach(thread);
+
+  return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef COUNTER_H
+#define COUNTER_H
+
+#include "debug.h"
+#include "histogram.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <signal.h>
+#include <pthread.h>
+
+#define COUNTER_ALIGN      64 // The size of a cache line
+#define COUNTER_DIRECTIONS 8
+#define COUNTER_NAME_SIZE  48
+
+/*
+ * The counters of one side (read or write) of a direction
+ *
+ * Every block is only updated by the thread that owns it, and is on its own cache line,
+ * so an update is a plain load and store, without locks or contention
+ */
+struct counters
+{
+  size_t lines;
+  size_t bytes;
+  size_t syscalls;
+  size_t partials;
+  size_t eagains;
+  size_t errors;
+} __attribute__((aligned(COUNTER_ALIGN)));
+
+/*
+ * The hops of a line through a direction
+ */
+enum hop
+{
+  HOP_READ,  // Waiting in read
+  HOP_FRAME, // Copying and framing, once per chunk of lines
+  HOP_WRITE, // Blocked in write
+  HOP_COUNT
+};
+
+/*
+ * A direction that lines are relayed in, like stdin => socket
+ *
+ * If the direction is timed, the time of every hop is recorded in its histogram
+ */
+struct direction
+{
+  char             name[COUNTER_NAME_SIZE];
+  bool             timed;
+  struct counters  read;
+  struct counters  write;
+  struct histogram hops[HOP_COUNT];
+};
+
+/*
+ * Add to a counter, if there are counters
+ *
+ * The store is atomic, so the dumping thread never reads a torn value
+ */
+#define COUNTER_ADD(counters, field, value) \
+  do { if(counters) __atomic_store_n(&(counters)->field, (counters)->field + (value), __ATOMIC_RELAXED); } while(0)
+
+extern struct direction* direction_create(const char* name);
+
+extern void              directions_print(void);
+
+extern int               directions_dump_start(bool debug);
+
+#endif // COUNTER_H
@@ -1,250 +1,680 @@
 /*
  * Written by Hampus Fridholm
  *
- * Last updated: 2024-09-08
+ * Last updated: 2026-10-15
  */
 
 #include "debug.h"
 
+#define LOG_LINE_SIZE 2048
+
 /*
- * Format string of current time in timezone with hours, minuts, seconds and ms
+ * A message in the ring of the logger
  *
- * PARAMS
- * - char* buffer              | Buffer to store format string
- * - struct timezone* timezone | Timezone
+ * The message is stored raw: the format, which has to be a string literal,
+ * and the arguments that it refers to, with strings copied into the payload
  *
- * RETURN (char* buffer)
- * - NULL | Failed to get time of day
+ * The sequence tells the state of the slot at ring position pos:
+ * - pos            | Free, for the producer that claims pos
+ * - pos + 1        | Filled, for the logger thread
+ * - pos + LOG_SLOTS | Free again, for the producer that claims pos + LOG_SLOTS
  */
-static char* time_format_string(char* buffer, struct timezone* timezone)
+struct log_slot
 {
-  struct timeval timeval;
-  if(gettimeofday(&timeval, timezone) == -1) return NULL;
-
-  struct tm* timeinfo = localtime(&timeval.tv_sec);
-
-  strftime(buffer, 10, "%H:%M:%S", timeinfo);
-
-  sprintf(buffer + 8, ".%03ld", timeval.tv_usec / 1000);
+  size_t          sequence;
+  FILE*           stream;
+  const char*     format;
+  struct timespec time;
+  char            title[LOG_TITLE_SIZE];
+  char            payload[LOG_PAYLOAD_SIZE];
+} __attribute__((aligned(64)));
 
-  return buffer;
-}
+/*
+ * The logger, with a lock-free ring that any thread can put messages in,
+ * and a thread that formats and writes them
+ *
+ * The producers only claim a slot and copy the raw message into it,
+ * the formatting, the local time and the writing are done by the logger thread
+ *
+ * The write lock guards the formatting state, because without the logger thread,
+ * every thread writes its own messages
+ */
+static struct
+{
+  pthread_mutex_t  lock;
+  struct log_slot* slots;
+  pthread_t        thread;
+  bool             running;
+  uint32_t         waiting;
+  size_t           dropped;
+  size_t           tail __attribute__((aligned(64)));
+  size_t           head __attribute__((aligned(64)));
+} logger = { .lock = PTHREAD_MUTEX_INITIALIZER };
 
 /*
- * Parse va_list argument and print it to a buffer
+ * A conversion of a format, with the flags, the width, the precision
+ * and the length modifiers that come before it
  *
- * PARAMS
- * - char* buffer          | Buffer to store printed argument
- * - const char* specifier | Argument format specifier
- * - va_list args          | va_list argument list
+ * A width or precision of * is an int argument, that comes before the argument of the conversion
+ */
+struct log_conversion
+{
+  const char* flags;
+  size_t      flags_length;
+  int         width;     // -1 if there is no width
+  bool        width_star;
+  int         precision; // -1 if there is no precision
+  bool        precision_star;
+  int         longs;
+  bool        sized;
+  bool        wide;      // long double, which the logger can't store
+  char        conversion;
+};
+
+/*
+ * Parse the conversion that starts after a '%' in the format
  *
- * RETURN (same as sprintf)
- * - >=0 | Number of printed characters
- * -  -1 | Format specifier does not exist, or sprintf error
+ * RETURN (const char* pointer)
+ * - The rest of the format, after the conversion
  */
-static int format_specifier_arg_append(char* buffer, const char* specifier, va_list args)
+static const char* log_conversion_parse(const char* pointer, struct log_conversion* conversion)
 {
-  if(!strncmp(specifier, "d", 1))
+  *conversion = (struct log_conversion) { .width = -1, .precision = -1 };
+
+  conversion->flags = pointer;
+
+  conversion->flags_length = strspn(pointer, "-+ #0");
+
+  pointer += conversion->flags_length;
+
+  if(*pointer == '*')
   {
-    int arg = va_arg(args, int);
+    conversion->width_star = true;
 
-    return sprintf(buffer, "%d", arg);
+    pointer++;
   }
-  else if(!strncmp(specifier, "ld", 2))
+  else if(*pointer >= '0' && *pointer <= '9')
   {
-    long int arg = va_arg(args, long int);
-
-    return sprintf(buffer, "%ld", arg);
+    conversion->width = strtol(pointer, (char**) &pointer, 10);
   }
-  else if(!strncmp(specifier, "lld", 2))
+
+  if(*pointer == '.')
   {
-    long long int arg = va_arg(args, long long int);
+    pointer++;
+
+    if(*pointer == '*')
+    {
+      conversion->precision_star = true;
 
-    return sprintf(buffer, "%lld", arg);
+      pointer++;
+    }
+    // An empty precision is a precision of zero
+    else conversion->precision = strtol(pointer, (char**) &pointer, 10);
   }
-  else if(!strncmp(specifier, "c", 1))
+
+  for(; *pointer && strchr("lzhjtL", *pointer); pointer++)
   {
-    // ‘char’ is promoted to ‘int’ when passed through ‘...’
-    int arg = va_arg(args, int);
+    if(*pointer == 'l') conversion->longs++;
+
+    if(*pointer == 'j') conversion->longs = 2;
 
-    return sprintf(buffer, "%c", arg);
+    if(*pointer == 'z' || *pointer == 't') conversion->sized = true;
+
+    if(*pointer == 'L') conversion->wide = true;
   }
-  else if(!strncmp(specifier, "f", 1))
+
+  conversion->conversion = *pointer;
+
+  if(*pointer) pointer++;
+
+  return pointer;
+}
+
+/*
+ * Check if the logger can store the argument of the conversion
+ */
+static bool log_conversion_supported(const struct log_conversion* conversion)
+{
+  if(conversion->wide || conversion->conversion == '\0') return false;
+
+  return strchr("diuxXocpfFeEgGaAs%", conversion->conversion) != NULL;
+}
+
+/*
+ * Store bytes in the payload, if they fit, and move past them
+ */
+static void log_payload_store(char* payload, size_t* size, const void* bytes, size_t length)
+{
+  if(*size + length <= LOG_PAYLOAD_SIZE) memcpy(payload + *size, bytes, length);
+
+  *size += length;
+}
+
+/*
+ * Load bytes from the payload, if they are there, and move past them
+ */
+static void log_payload_load(const char* payload, size_t* size, void* bytes, size_t length)
+{
+  if(*size + length <= LOG_PAYLOAD_SIZE) memcpy(bytes, payload + *size, length);
+
+  *size += length;
+}
+
+/*
+ * Encode the arguments of the format into the payload
+ *
+ * Integers and pointers are stored as long long, and floats as double,
+ * strings are stored as a 16 bit length followed by the bytes,
+ * and a * width or precision is stored as an int
+ *
+ * Encoding stops at a conversion that the logger can't store,
+ * because the arguments after it can't be found
+ */
+static void log_args_encode(char* payload, const char* format, va_list args)
+{
+  size_t size = 0;
+
+  for(const char* pointer = format; (pointer = strchr(pointer, '%')); )
   {
-    // ‘float’ is promoted to ‘double’ when passed through ‘...’
-    double arg = va_arg(args, double);
+    struct log_conversion conversion;
+
+    pointer = log_conversion_parse(pointer + 1, &conversion);
 
-    return sprintf(buffer, "%lf", arg);
+    if(!log_conversion_supported(&conversion)) break;
+
+    if(conversion.width_star)
+    {
+      int width = va_arg(args, int);
+
+      log_payload_store(payload, &size, &width, sizeof(width));
+    }
+
+    if(conversion.precision_star)
+    {
+      conversion.precision = va_arg(args, int);
+
+      log_payload_store(payload, &size, &conversion.precision, sizeof(conversion.precision));
+    }
+
+    long long integer = 0;
+
+    double real = 0;
+
+    switch(conversion.conversion)
+    {
+      case 'd': case 'i': case 'c':
+        integer = conversion.sized ? (long long) va_arg(args, ssize_t) :
+                  (conversion.longs == 2) ? va_arg(args, long long) :
+                  (conversion.longs == 1) ? va_arg(args, long) : va_arg(args, int);
+        break;
+
+      case 'u': case 'x': case 'X': case 'o':
+        integer = conversion.sized ? (long long) va_arg(args, size_t) :
+                  (conversion.longs == 2) ? (long long) va_arg(args, unsigned long long) :
+                  (conversion.longs == 1) ? (long long) va_arg(args, unsigned long) : (long long) va_arg(args, unsigned int);
+        break;
+
+      case 'p':
+        integer = (long long) (uintptr_t) va_arg(args, void*);
+        break;
+
+      case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        real = va_arg(args, double);
+
+        log_payload_store(payload, &size, &real, sizeof(real));
+        continue;
+
+      case 's':
+        const char* string = va_arg(args, const char*);
+
+        if(!string) string = "(null)";
+
+        // A string with a precision doesn't have to be terminated
+        size_t length = (conversion.precision >= 0) ? strnlen(string, conversion.precision) : strlen(string);
+
+        // The string is cut to fit in the rest of the payload
+        size_t space = (size + sizeof(uint16_t) < LOG_PAYLOAD_SIZE) ? LOG_PAYLOAD_SIZE - size - sizeof(uint16_t) : 0;
+
+        if(length > space) length = space;
+
+        if(size + sizeof(uint16_t) <= LOG_PAYLOAD_SIZE)
+        {
+          uint16_t stored = length;
+
+          memcpy(payload + size, &stored, sizeof(stored));
+
+          memcpy(payload + size + sizeof(stored), string, length);
+        }
+
+        size += sizeof(uint16_t) + length;
+        continue;
+
+      default: // '%' has no argument
+        continue;
+    }
+
+    log_payload_store(payload, &size, &integer, sizeof(integer));
   }
-  else if(!strncmp(specifier, "s", 1))
+}
+
+/*
+ * Build the snprintf format of a conversion, with its width and precision as numbers
+ *
+ * A negative * width is left-justified, and a negative * precision is left out, like in printf
+ */
+static void log_spec_build(char* spec, size_t spec_size, const struct log_conversion* conversion, int width, int precision, const char* length)
+{
+  bool left = false;
+
+  if(conversion->width_star && width < 0)
   {
-    const char* arg = va_arg(args, const char*);
+    left = true;
 
-    return sprintf(buffer, "%s", arg);
+    width = (width == INT_MIN) ? INT_MAX : -width;
   }
-  else return -1; // Specifier does not exist
+
+  int flags_length = (conversion->flags_length < 8) ? conversion->flags_length : 8;
+
+  int written = snprintf(spec, spec_size, "%%%.*s%s", flags_length, conversion->flags, left ? "-" : "");
+
+  if(width >= 0) written += snprintf(spec + written, spec_size - written, "%d", width);
+
+  if(precision >= 0) written += snprintf(spec + written, spec_size - written, ".%d", precision);
+
+  snprintf(spec + written, spec_size - written, "%s%c", length, conversion->conversion);
 }
 
 /*
- * Part of function format_args_string
- * Formats just a single format specifier argument from va_list
+ * Format a message from its format and its encoded arguments,
+ * using snprintf for every conversion
+ *
+ * A conversion that the logger can't store is written as %!c(UNSUPPORTED),
+ * and ends the message, because the arguments after it are unknown
  *
- * RETURN (same as sprintf)
- * - >=0 | Number of printed characters
- * -  -1 | Format specifier does not exist, or sprintf error
+ * RETURN (size_t length)
+ * - The length of the formatted message
  */
-static int format_arg_append(char* buffer, const char* format, int* f_index, va_list args)
+static size_t log_message_format(char* buffer, size_t buffer_size, const char* format, const char* payload)
 {
-  const size_t f_length = strlen(format);
+  size_t length = 0, size = 0;
 
-  char specifier[f_length + 1];
+  char spec[64], string[LOG_PAYLOAD_SIZE + 1];
 
-  for(int s_index = 0; (*f_index)++ < f_length; s_index++)
+  for(const char* pointer = format; *pointer && length + 1 < buffer_size; )
   {
-    specifier[s_index]     = format[*f_index];
-    specifier[s_index + 1] = '\0';
+    if(*pointer != '%')
+    {
+      buffer[length++] = *pointer++;
+
+      continue;
+    }
+
+    struct log_conversion conversion;
+
+    pointer = log_conversion_parse(pointer + 1, &conversion);
+
+    size_t space = buffer_size - length;
+
+    if(!log_conversion_supported(&conversion))
+    {
+      int status = snprintf(buffer + length, space, "%%!%c(UNSUPPORTED)", conversion.conversion ? conversion.conversion : '?');
+
+      if(status > 0) length += ((size_t) status < space) ? (size_t) status : space - 1;
+
+      break;
+    }
+
+    int width = conversion.width, precision = conversion.precision;
+
+    if(conversion.width_star) log_payload_load(payload, &size, &width, sizeof(width));
+
+    if(conversion.precision_star) log_payload_load(payload, &size, &precision, sizeof(precision));
+
+    int status = 0;
 
-    int status = format_specifier_arg_append(buffer, specifier, args);
+    switch(conversion.conversion)
+    {
+      case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c': case 'p':
+        long long integer = 0;
+
+        log_payload_load(payload, &size, &integer, sizeof(integer));
+
+        if(conversion.conversion == 'c')
+        {
+          log_spec_build(spec, sizeof(spec), &conversion, width, precision, "");
+
+          status = snprintf(buffer + length, space, spec, (int) integer);
+        }
+        else if(conversion.conversion == 'p')
+        {
+          log_spec_build(spec, sizeof(spec), &conversion, width, precision, "");
+
+          status = snprintf(buffer + length, space, spec, (void*) (uintptr_t) integer);
+        }
+        else
+        {
+          log_spec_build(spec, sizeof(spec), &conversion, width, precision, "ll");
+
+          status = snprintf(buffer + length, space, spec, integer);
+        }
+        break;
+
+      case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        double real = 0;
+
+        log_payload_load(payload, &size, &real, sizeof(real));
+
+        log_spec_build(spec, sizeof(spec), &conversion, width, precision, "");
+
+        status = snprintf(buffer + length, space, spec, real);
+        break;
+
+      case 's':
+        uint16_t stored = 0;
+
+        if(size + sizeof(stored) <= LOG_PAYLOAD_SIZE) memcpy(&stored, payload + size, sizeof(stored));
+
+        memcpy(string, payload + size + sizeof(stored), stored);
+
+        string[stored] = '\0';
 
-    // If a valid format specifier has been found and parsed,
-    // return the status of the appended specifier
-    if(status > 0) return status;
+        size += sizeof(stored) + stored;
+
+        // The precision is already applied to the stored string
+        log_spec_build(spec, sizeof(spec), &conversion, width, -1, "");
+
+        status = snprintf(buffer + length, space, spec, string);
+        break;
+
+      case '%':
+        buffer[length] = '%';
+
+        status = 1;
+        break;
+    }
+
+    if(status > 0) length += ((size_t) status < space) ? (size_t) status : space - 1;
   }
 
-  return -1;
+  buffer[length] = '\0';
+
+  return length;
 }
 
 /*
- * sprintf, but with va_list as arguments
+ * Format and write a message, with its time and title
  *
- * RETURN (same as sprintf)
- * - >=0 | Number of printed characters
- * -  -1 | Format specifier does not exist, or sprintf error
+ * The local time of the last second is kept, to not call localtime for every message,
+ * and the previous stream is flushed when the stream changes, to keep the messages in order
+ *
+ * Note: The caller has to hold the write lock of the logger
  */
-static int format_args_string(char* buffer, const char* format, va_list args)
+static void log_slot_write(const struct log_slot* slot)
 {
-  const size_t f_length = strlen(format);
+  static FILE* last_stream = NULL;
+
+  static time_t last_second = -1;
+
+  if(last_stream && slot->stream != last_stream) fflush(last_stream);
+
+  last_stream = slot->stream;
 
-  int b_index = 0;
+  static char time_string[16];
 
-  for(int f_index = 0; f_index < f_length; f_index++)
+  if(slot->time.tv_sec != last_second)
   {
-    if(format[f_index] == '%')
-    {
-      int status = format_arg_append(buffer + b_index, format, &f_index, args);
+    struct tm timeinfo;
 
-      // If failed to append format argument, return error
-      if(status < 0) return -1;
+    localtime_r(&slot->time.tv_sec, &timeinfo);
 
-      b_index = strlen(buffer);
-    }
-    else buffer[b_index++] = format[f_index];
+    strftime(time_string, sizeof(time_string), "%H:%M:%S", &timeinfo);
+
+    last_second = slot->time.tv_sec;
   }
 
-  return strlen(buffer);
+  char line[LOG_LINE_SIZE];
+
+  int length = snprintf(line, sizeof(line), "[%s.%03ld] [ %s ]: ", time_string, slot->time.tv_nsec / 1000000, slot->title);
+
+  length += log_message_format(line + length, sizeof(line) - length - 1, slot->format, slot->payload);
+
+  line[length++] = '\n';
+
+  fwrite(line, 1, length, slot->stream);
 }
 
 /*
- * fprintf, but with va_list as arguments and time with title
- *
- * RETURN (same as fprintf)
- * - >=0 | Number of printed characters
- * -  -1 | Format specifier does not exist, or sprintf error
+ * Fill a slot with the raw message
  */
-static int debug_args_print(FILE* stream, const char* title, const char* format, va_list args)
+static void log_slot_fill(struct log_slot* slot, FILE* stream, const char* title, const char* format, va_list args)
 {
-  char time_string[32];
-  memset(time_string, '\0', sizeof(time_string));
+  // The coarse clock is the time of the last tick, cached by the kernel
+  clock_gettime(CLOCK_REALTIME_COARSE, &slot->time);
 
-  time_format_string(time_string, NULL);
+  slot->stream = stream;
+  slot->format = format;
 
-  char buffer[1024];
-  memset(buffer, '\0', sizeof(buffer));
+  strncpy(slot->title, title, LOG_TITLE_SIZE - 1);
 
-  int status = format_args_string(buffer, format, args);
+  slot->title[LOG_TITLE_SIZE - 1] = '\0';
 
-  // If failed to create format string, return error
-  if(status < 0) return -1;
+  log_args_encode(slot->payload, format, args);
+}
 
-  return fprintf(stream, "[%s] [ %s ]: %s\n", time_string, title, buffer);
+/*
+ * Wake up the logger thread, if it is sleeping on the futex
+ */
+static void log_wake(void)
+{
+  if(__atomic_load_n(&logger.waiting, __ATOMIC_SEQ_CST) == 1 && __atomic_exchange_n(&logger.waiting, 0, __ATOMIC_SEQ_CST) == 1)
+  {
+    syscall(SYS_futex, &logger.waiting, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+  }
 }
 
 /*
- * sprintf - my own implementation
+ * Put a message in the ring of the logger, for the logger thread to write
  *
- * RETURN (same as sprintf)
- * - >=0 | Number of printed characters
- * -  -1 | Format specifier does not exist, or sprintf error
+ * If the logger is not running, the message is written right away,
+ * and if the ring is full, the message is dropped instead of waiting
+ *
+ * Note: The format has to be a string literal
  */
-int format_string(char* buffer, const char* format, ...)
+void log_print(FILE* stream, const char* title, const char* format, ...)
 {
+  int saved_errno = errno;
+
   va_list args;
 
   va_start(args, format);
 
-  int status = format_args_string(buffer, format, args);
+  if(!__atomic_load_n(&logger.running, __ATOMIC_ACQUIRE))
+  {
+    struct log_slot slot;
+
+    log_slot_fill(&slot, stream, title, format, args);
+
+    pthread_mutex_lock(&logger.lock);
+
+    log_slot_write(&slot);
+
+    fflush(stream);
+
+    pthread_mutex_unlock(&logger.lock);
+  }
+  else
+  {
+    size_t pos = __atomic_load_n(&logger.head, __ATOMIC_RELAXED);
+
+    struct log_slot* slot = NULL;
+
+    while(true)
+    {
+      slot = &logger.slots[pos & (LOG_SLOTS - 1)];
+
+      size_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+
+      if(sequence == pos)
+      {
+        if(__atomic_compare_exchange_n(&logger.head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+      }
+      else if(sequence < pos)
+      {
+        slot = NULL; // The ring is full
+
+        break;
+      }
+      else pos = __atomic_load_n(&logger.head, __ATOMIC_RELAXED);
+    }
+
+    if(slot)
+    {
+      log_slot_fill(slot, stream, title, format, args);
+
+      __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+
+      // The logger thread flushes on an interval, unless the ring is filling up
+      if(pos - __atomic_load_n(&logger.tail, __ATOMIC_RELAXED) >= LOG_SLOTS / 2) log_wake();
+    }
+    else __atomic_fetch_add(&logger.dropped, 1, __ATOMIC_RELAXED);
+  }
 
   va_end(args);
 
-  return status;
+  errno = saved_errno;
 }
 
 /*
- * fprintf, but with time and title
+ * Write the filled slots of the ring, in order
  *
- * RETURN (same as fprintf)
- * - >=0 | Number of printed characters
- * -  -1 | Format specifier does not exist, or sprintf error
+ * RETURN (size_t count)
+ * - The number of written messages
  */
-int debug_print(FILE* stream, const char* title, const char* format, ...)
+static size_t log_drain(void)
 {
-  va_list args;
+  size_t count = 0;
 
-  va_start(args, format);
+  pthread_mutex_lock(&logger.lock);
+
+  while(true)
+  {
+    size_t pos = logger.tail;
 
-  int status = debug_args_print(stream, title, format, args);
+    struct log_slot* slot = &logger.slots[pos & (LOG_SLOTS - 1)];
 
-  va_end(args);
+    if(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != pos + 1) break;
+
+    log_slot_write(slot);
+
+    __atomic_store_n(&slot->sequence, pos + LOG_SLOTS, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&logger.tail, pos + 1, __ATOMIC_RELAXED);
+
+    count++;
+  }
+
+  if(count > 0)
+  {
+    fflush(stdout);
+
+    fflush(stderr);
+  }
+
+  pthread_mutex_unlock(&logger.lock);
+
+  size_t dropped = __atomic_exchange_n(&logger.dropped, 0, __ATOMIC_RELAXED);
+
+  if(dropped > 0) fprintf(stderr, "[ LOG ]: Dropped %ld messages, the ring was full\n", (long) dropped);
+
+  return count;
+}
+
+/*
+ * The logger thread writes the messages of the ring,
+ * and sleeps for an interval when the ring is empty
+ */
+static void* log_routine(void* arg)
+{
+  // The signals are for the relay threads, not for the logger
+  sigset_t sigset;
+
+  sigfillset(&sigset);
+
+  pthread_sigmask(SIG_BLOCK, &sigset, NULL);
+
+  struct timespec timeout = { .tv_sec = 0, .tv_nsec = LOG_INTERVAL * 1000000L };
+
+  while(__atomic_load_n(&logger.running, __ATOMIC_ACQUIRE))
+  {
+    if(log_drain() > 0) continue;
+
+    __atomic_store_n(&logger.waiting, 1, __ATOMIC_SEQ_CST);
 
-  return status;
+    syscall(SYS_futex, &logger.waiting, FUTEX_WAIT_PRIVATE, 1, &timeout, NULL, 0);
+
+    __atomic_store_n(&logger.waiting, 0, __ATOMIC_SEQ_CST);
+  }
+
+  log_drain();
+
+  return NULL;
 }
 
 /*
- * fprintf to stderr, but with time and "ERROR" title
+ * Start the logger thread, after which messages are written asynchronously
  *
- * RETURN (same as fprintf)
- * - >=0 | Number of printed characters
- * -  -1 | Format specifier does not exist, or sprintf error
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to allocate the ring or to start the thread
  */
-int error_print(const char* format, ...)
+int log_start(void)
 {
-  va_list args;
+  if(posix_memalign((void**) &logger.slots, 64, sizeof(struct log_slot) * LOG_SLOTS) != 0)
+  {
+    logger.slots = NULL;
 
-  va_start(args, format);
+    return -1;
+  }
 
-  int status = debug_args_print(stderr, "\e[1;31mERROR\e[0m", format, args);
+  for(size_t index = 0; index < LOG_SLOTS; index++) logger.slots[index].sequence = index;
 
-  va_end(args);
+  logger.head = 0;
+  logger.tail = 0;
+
+  __atomic_store_n(&logger.running, true, __ATOMIC_RELEASE);
+
+  if(pthread_create(&logger.thread, NULL, log_routine, NULL) != 0)
+  {
+    __atomic_store_n(&logger.running, false, __ATOMIC_RELEASE);
+
+    free(logger.slots);
+
+    logger.slots = NULL;
 
-  return status;
+    return -1;
+  }
+
+  return 0;
 }
 
 /*
- * fprintf to stdout, but with time and "INFO" title
+ * Stop the logger thread, after it has written the messages left in the ring
  *
- * RETURN (same as fprintf)
- * - >=0 | Number of printed characters
- * -  -1 | Format specifier does not exist, or sprintf error
+ * Note: The other threads should be done logging
  */
-int info_print(const char* format, ...)
+void log_stop(void)
 {
-  va_list args;
+  if(!logger.slots) return;
 
-  va_start(args, format);
+  __atomic_store_n(&logger.running, false, __ATOMIC_RELEASE);
 
-  int status = debug_args_print(stdout, "\e[1;37mINFO \e[0m", format, args);
+  __atomic_store_n(&logger.waiting, 0, __ATOMIC_SEQ_CST);
 
-  va_end(args);
+  syscall(SYS_futex, &logger.waiting, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+
+  pthread_join(logger.thread, NULL);
+
+  free(logger.slots);
 
-  return status;
+  logger.slots = NULL;
 }
@@ -1,24 +1,67 @@
 /*
  * Written by Hampus Fridholm
  *
- * Last updated: 2024-09-08
+ * Last updated: 2026-10-15
  */
 
 #ifndef DEBUG_H
 #define DEBUG_H
 
 #include <stdio.h>
-#include <sys/time.h>
-#include <time.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_DEBUG 3
+
+// The levels above LOG_LEVEL are compiled out, like with make LOG_LEVEL=1
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#define LOG_SLOTS        4096 // Has to be a power of two
+#define LOG_TITLE_SIZE   32
+#define LOG_PAYLOAD_SIZE 928  // The raw arguments of a message, strings are cut to fit
+#define LOG_INTERVAL     10   // Milliseconds between flushes of the logger thread
+
+extern int  log_start(void);
+
+extern void log_stop(void);
+
+extern void log_print(FILE* stream, const char* title, const char* format, ...) __attribute__((format(printf, 3, 4)));
 
-extern int debug_print(FILE* stream, const char* title, const char* format, ...);
+// A compiled out message is still type checked, but never evaluated
+#define LOG_DISCARD(...) do { if(0) log_print(__VA_ARGS__); } while(0)
 
-extern int error_print(const char* format, ...);
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define debug_print(stream, title, ...) log_print(stream, title, __VA_ARGS__)
+#else
+#define debug_print(stream, title, ...) LOG_DISCARD(stream, title, __VA_ARGS__)
+#endif
 
-extern int info_print(const char* format, ...);
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define info_print(...) log_print(stdout, "\e[1;37mINFO \e[0m", __VA_ARGS__)
+#else
+#define info_print(...) LOG_DISCARD(stdout, "", __VA_ARGS__)
+#endif
 
-extern int format_string(char* buffer, const char* format, ...);
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define error_print(...) log_print(stderr, "\e[1;31mERROR\e[0m", __VA_ARGS__)
+#else
+#define error_print(...) LOG_DISCARD(stderr, "", __VA_ARGS__)
+#endif
 
 #endif // DEBUG_H
@@ -0,0 +1,340 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#include "event.h"
+
+/*
+ * epoll_create, with debug messages
+ *
+ * RETURN (int epollfd)
+ * - >=0 | Success
+ * -  -1 | Failed to create event loop
+ */
+int event_loop_create(bool debug)
+{
+  if(debug) info_print("Creating event loop");
+
+  int epollfd = epoll_create1(0);
+
+  if(epollfd == -1)
+  {
+    if(debug) error_print("Failed to create event loop: %s", strerror(errno));
+
+    return -1;
+  }
+
+  if(debug) info_print("Created event loop (%d)", epollfd);
+
+  return epollfd;
+}
+
+/*
+ * close, but with pointer to event loop, and with debug messages
+ *
+ * Note: If no open event loop is supplied, nothing is done
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to close event loop
+ */
+int event_loop_close(int* epollfd, bool debug)
+{
+  if(!epollfd || *epollfd == -1) return 0;
+
+  if(debug) info_print("Closing event loop (%d)", *epollfd);
+
+  if(close(*epollfd) == -1)
+  {
+    if(debug) error_print("Failed to close event loop: %s", strerror(errno));
+
+    return 1;
+  }
+
+  if(debug) info_print("Closed event loop");
+
+  *epollfd = -1;
+
+  return 0;
+}
+
+/*
+ * Add file descriptor to the event loop
+ *
+ * Note: Regular files can't be added (EPERM), but they never block,
+ *       so they are always treated as ready
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to add file descriptor
+ */
+static int event_fd_add(int epollfd, int fd, uint32_t events, bool debug)
+{
+  struct epoll_event event = { .events = events, .data.fd = fd };
+
+  if(epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &event) == -1)
+  {
+    if(errno == EPERM || errno == EEXIST)
+    {
+      errno = 0;
+
+      return 0;
+    }
+
+    if(debug) error_print("Failed to add (%d) to event loop: %s", fd, strerror(errno));
+
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * Wait for a client on the event loop, and accept it
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to accept client, or interrupted
+ */
+int event_socket_accept(int epollfd, int* sockfd, int servfd, bool debug)
+{
+  if(event_fd_add(epollfd, servfd, EPOLLIN, debug) == -1) return -1;
+
+  struct epoll_event event;
+
+  int status = epoll_wait(epollfd, &event, 1, -1);
+
+  epoll_ctl(epollfd, EPOLL_CTL_DEL, servfd, NULL);
+
+  if(status == -1)
+  {
+    if(debug) error_print("Failed to wait for client: %s", strerror(errno));
+
+    return -1;
+  }
+
+  *sockfd = socket_accept(servfd, debug);
+
+  return (*sockfd == -1) ? -1 : 0;
+}
+
+/*
+ * Make file descriptor non-blocking
+ *
+ * RETURN (int flags)
+ * - >=0 | The previous flags, to restore later
+ * -  -1 | Failed to get or set flags
+ */
+int event_fd_nonblock(int fd)
+{
+  int flags = fcntl(fd, F_GETFL);
+
+  if(flags == -1) return -1;
+
+  if(fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) return -1;
+
+  return flags;
+}
+
+/*
+ * Read lines and write them, until either the reader or the writer would block
+ *
+ * RETURN (int status)
+ * -  0 | Waiting for events
+ * -  1 | End of file, and all lines are written
+ * - -1 | Failed to read or write
+ */
+static int relay_pump(struct relay* relay)
+{
+  const char* lines;
+
+  while(true)
+  {
+    // 1. Send the pending lines, before reading new lines
+    if(writer_pending(&relay->writer))
+    {
+      if(!relay->writable) return 0;
+
+      int status = writer_flush_nonblock(&relay->writer);
+
+      if(status == -1) return -1;
+
+      if(status == 1)
+      {
+        relay->writable = false;
+
+        return 0;
+      }
+    }
+
+    if(relay->done) return 1;
+
+    if(!relay->readable) return 0;
+
+    // 2. Read chunks of lines, as long as they fit in the send buffer,
+    //    so that writing them never blocks
+    while(relay->writer.end < relay->writer.size)
+    {
+      ssize_t read_size = reader_lines_read(&relay->reader, &lines, relay->writer.size - relay->writer.end);
+
+      if(read_size == -1)
+      {
+        if(errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+
+        errno = 0;
+
+        relay->readable = false;
+
+        break;
+      }
+
+      if(read_size == 0)
+      {
+        relay->done = true;
+
+        break;
+      }
+
+      if(relay->write(&relay->writer, lines, read_size) <= 0) return -1;
+    }
+  }
+}
+
+/*
+ * Mark the relays of the file descriptor as ready
+ */
+static void relays_event_mark(struct relay* relays, int count, struct epoll_event* event)
+{
+  for(int index = 0; index < count; index++)
+  {
+    struct relay* relay = &relays[index];
+
+    if(relay->reader.fd == event->data.fd && (event->events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+    {
+      relay->readable = true;
+    }
+
+    if(relay->writer.fd == event->data.fd && (event->events & (EPOLLOUT | EPOLLHUP | EPOLLERR)))
+    {
+      relay->writable = true;
+    }
+  }
+}
+
+/*
+ * Add the file descriptors of the relays to the event loop,
+ * and make them non-blocking
+ *
+ * The previous flags are stored in flags, to be restored later
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to add file descriptors
+ */
+static int relays_fds_add(int epollfd, struct relay* relays, int count, int* flags, bool debug)
+{
+  for(int index = 0; index < count; index++)
+  {
+    int fds[2] = { relays[index].reader.fd, relays[index].writer.fd };
+
+    for(int side = 0; side < 2; side++)
+    {
+      flags[index * 2 + side] = event_fd_nonblock(fds[side]);
+
+      // Edge triggered, both directions, because the socket is shared by the relays
+      if(event_fd_add(epollfd, fds[side], EPOLLIN | EPOLLOUT | EPOLLET, debug) == -1) return -1;
+    }
+
+    relays[index].readable = true;
+    relays[index].writable = true;
+    relays[index].done     = false;
+  }
+
+  return 0;
+}
+
+/*
+ * Restore the flags of the file descriptors of the relays,
+ * not to leave stdin and stdout non-blocking
+ */
+static void relays_fds_restore(struct relay* relays, int count, int* flags)
+{
+  for(int index = count - 1; index >= 0; index--)
+  {
+    int fds[2] = { relays[index].reader.fd, relays[index].writer.fd };
+
+    for(int side = 1; side >= 0; side--)
+    {
+      if(flags[index * 2 + side] != -1) fcntl(fds[side], F_SETFL, flags[index * 2 + side]);
+    }
+  }
+}
+
+/*
+ * Drive all relays of a bridge from a single thread,
+ * using non-blocking I/O
+ *
+ * The loop ends when one of the relays reaches end of file, like the threads
+ *
+ * RETURN (int status)
+ * - 0 | Success, end of file
+ * - 1 | Failed to add file descriptors
+ * - 2 | Failed to relay, or interrupted
+ */
+int event_loop_run(int epollfd, struct relay* relays, int count, bool debug)
+{
+  int flags[count * 2];
+
+  for(int index = 0; index < count * 2; index++) flags[index] = -1;
+
+  int status = 0;
+
+  bool done = false;
+
+  if(relays_fds_add(epollfd, relays, count, flags, debug) == -1) status = 1;
+
+  if(debug && status == 0) info_print("Start of event loop");
+
+  while(status == 0 && !done)
+  {
+    for(int index = 0; index < count && status == 0 && !done; index++)
+    {
+      int pump_status = relay_pump(&relays[index]);
+
+      if(pump_status == 1) done = true;
+
+      else if(pump_status == -1) status = 2;
+    }
+
+    if(status != 0 || done) break;
+
+    struct epoll_event events[EVENT_COUNT];
+
+    int event_count = epoll_wait(epollfd, events, EVENT_COUNT, -1);
+
+    if(event_count == -1)
+    {
+      status = 2;
+
+      break;
+    }
+
+    for(int index = 0; index < event_count; index++)
+    {
+      relays_event_mark(relays, count, &events[index]);
+    }
+  }
+
+  if(status == 2 && errno != 0)
+  {
+    if(debug) error_print("%s", strerror(errno));
+  }
+
+  if(debug) info_print("End of event loop");
+
+  relays_fds_restore(relays, count, flags);
+
+  return status;
+}
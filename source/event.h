@@ -0,0 +1,50 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef EVENT_H
+#define EVENT_H
+
+#include "debug.h"
+#include "socket.h"
+#include "reader.h"
+#include "writer.h"
+
+#include <stdbool.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#define EVENT_COUNT 16
+
+/*
+ * One direction of a bridge, driven by the event loop
+ *
+ * Lines are read by reader and handed to write,
+ * which adds them to the batch of writer
+ */
+struct relay
+{
+  struct reader reader;
+  struct writer writer;
+  ssize_t     (*write) (struct writer*, const char*, size_t);
+  bool          readable;
+  bool          writable;
+  bool          done;
+};
+
+extern int event_loop_create(bool debug);
+
+extern int event_fd_nonblock(int fd);
+
+extern int event_loop_close(int* epollfd, bool debug);
+
+extern int event_socket_accept(int epollfd, int* sockfd, int servfd, bool debug);
+
+extern int event_loop_run(int epollfd, struct relay* relays, int count, bool debug);
+
+#endif // EVENT_H
@@ -1,190 +1,318 @@
 /*
  * Written by Hampus Fridholm
  *
- * Last updated: 2024-09-08
+ * Last updated: 2026-10-15
  */
 
+#define _GNU_SOURCE
+
 #include "fifo.h"
 
+// The tuned fifos, by file descriptor
+static struct fifo_pipe pipes[FIFO_PIPES];
+
+// The largest pipe capacity to grow to, or 0 not to tune the fifos
+static int pipe_limit = 0;
+
 /*
- * Open fifo for reading (input/stdin fifo)
- * 
- * Optionally print debug messages
+ * Set the largest capacity that the pipes of fifos are grown to
  *
- * RETURN (int status)
- * - 0 | Success
- * - 1 | Missing address for stdin fifo
- * - 2 | Missing path to stdin fifo
- * - 3 | Failed to open stdin fifo
+ * Note: The fifos are only tuned if the limit is set before they are opened
  */
-static int stdin_fifo_open(int* fifo, const char* path, bool debug)
+void fifo_pipe_limit_set(int limit)
 {
-  if(!fifo)
-  {
-    if(debug) error_print("Missing address for stdin fifo");
+  pipe_limit = limit;
+}
 
-    return 1;
-  }
+/*
+ * Start tuning the pipe capacity of a fifo, from its current capacity
+ */
+static void fifo_pipe_track(int fd, const char* path)
+{
+  if(pipe_limit == 0 || fd >= FIFO_PIPES) return;
+
+  int capacity = fcntl(fd, F_GETPIPE_SZ);
 
-  if(!path)
+  if(capacity == -1)
   {
-    if(debug) error_print("Missing path to stdin fifo");
+    errno = 0;
 
-    return 2;
+    return;
   }
 
-  if(debug) info_print("Opening stdin fifo (%s)", path);
+  pipes[fd] = (struct fifo_pipe) { .path = path, .capacity = capacity, .limit = pipe_limit, .tuned = true };
+}
+
+/*
+ * Double the pipe capacity of a fifo, up to the limit
+ *
+ * If the system doesn't allow a larger pipe (pipe-max-size),
+ * the fifo keeps the capacity it has, and stops growing
+ */
+static void fifo_pipe_grow(struct fifo_pipe* tuning, int fd)
+{
+  int capacity = (tuning->capacity * 2 < tuning->limit) ? tuning->capacity * 2 : tuning->limit;
+
+  int status = fcntl(fd, F_SETPIPE_SZ, capacity);
 
-  if((*fifo = open(path, O_RDONLY)) == -1)
+  if(status == -1)
   {
-    if(debug) error_print("Failed to open stdin fifo (%s)", path);
-    
-    return 3;
+    tuning->limit = tuning->capacity;
+
+    return;
   }
 
-  if(debug) info_print("Opened stdin fifo (%s): (%d)", path, *fifo);
+  tuning->capacity = status;
 
-  return 0;
+  tuning->resizes++;
 }
 
 /*
- * Open fifo for writing (output/stdout fifo)
- * 
- * Optionally print debug messages
+ * Record the fill level of a tuned fifo, and grow its pipe
+ * if it is more than three quarters full
  *
- * RETURN (int status)
- * - 0 | Success
- * - 1 | Missing address for stdout fifo
- * - 2 | Missing path to stdout fifo
- * - 3 | Failed to open stdout fifo
+ * Note: errno is preserved, not to trip the fill and flush functions
  */
-static int stdout_fifo_open(int* fifo, const char* path, bool debug)
+static void fifo_pipe_observe(int fd, size_t occupancy)
 {
-  if(!fifo)
-  {
-    if(debug) error_print("Missing address for stdout fifo");
+  struct fifo_pipe* tuning = &pipes[fd];
 
-    return 1;
-  }
+  int error = errno;
 
-  if(!path)
-  {
-    if(debug) error_print("Missing path to stdout fifo");
+  // Bytes that arrive while sampling can add up to more than the pipe holds
+  if(occupancy > (size_t) tuning->capacity) occupancy = tuning->capacity;
 
-    return 2;
-  }
+  if(occupancy > (size_t) tuning->peak) tuning->peak = occupancy;
 
-  if(debug) info_print("Opening stdout fifo (%s)", path);
+  if(occupancy * 4 >= (size_t) tuning->capacity * 3 && tuning->capacity < tuning->limit) fifo_pipe_grow(tuning, fd);
 
-  if((*fifo = open(path, O_WRONLY)) == -1)
-  {
-    if(debug) error_print("Failed to open stdout fifo (%s)", path);
+  errno = error;
+}
 
-    return 3;
-  }
-  
-  if(debug) info_print("Opened stdout fifo (%s): (%d)", path, *fifo);
+/*
+ * Get the number of bytes waiting in the pipe of a fifo
+ *
+ * RETURN (int size)
+ * - The number of bytes, or 0 if it can't be read
+ */
+static int fifo_pipe_queued(int fd)
+{
+  int error = errno;
 
-  return 0;
+  int queued = 0;
+
+  if(ioctl(fd, FIONREAD, &queued) == -1) queued = 0;
+
+  errno = error;
+
+  return queued;
 }
 
 /*
- * Close fifo and mark it as closed for future potential use
+ * Print the capacity that a tuned fifo ended up with, and its peak fill level
+ */
+static void fifo_pipe_report(int fd)
+{
+  const struct fifo_pipe* tuning = &pipes[fd];
+
+  log_print(stderr, "PIPE", "Fifo (%s) capacity %d bytes (%d resizes), peak occupancy %d bytes",
+    tuning->path, tuning->capacity, tuning->resizes, tuning->peak);
+}
+
+/*
+ * Open fifo without blocking, for reading (O_RDONLY) or for writing (O_WRONLY)
  *
- * Optionally print debug messages
+ * The reading end is opened right away, but the writing end
+ * can't be opened until the fifo has a reader
  *
- * Note: If no open fifo is supplied, nothing is done
+ * Note: The fifo is left non-blocking
  *
  * RETURN (int status)
- * - 0 | Success
- * - 1 | Failed to close stdin fifo
+ * -  0 | Success
+ * -  1 | The fifo has no reader yet, try again later
+ * - -1 | Failed to open fifo
  */
-int fifo_close(int* fifo, bool debug)
+int fifo_open_nonblock(int* fifo, const char* path, int flags, bool debug)
 {
-  if(!fifo || *fifo == -1) return 0;
-
-  if(debug) info_print("Closing fifo (%d)", *fifo);
+  int fd = open(path, flags | O_NONBLOCK);
 
-  if(close(*fifo) == -1)
+  if(fd == -1)
   {
-    if(debug) error_print("Failed to close fifo: %s", strerror(errno));
+    if(flags == O_WRONLY && errno == ENXIO)
+    {
+      errno = 0;
 
-    return 1;
+      return 1;
+    }
+
+    if(debug) error_print("Failed to open fifo (%s): %s", path, strerror(errno));
+
+    return -1;
   }
 
-  if(debug) info_print("Closed fifo");
+  if(debug) info_print("Opened fifo (%s) for %s: (%d)", path, (flags == O_WRONLY) ? "writing" : "reading", fd);
 
-  *fifo = -1;
+  fifo_pipe_track(fd, path);
+
+  *fifo = fd;
 
   return 0;
 }
 
 /*
- * PARAMS
- * - bool reverse
- *   - true  | First open stdin then stdout
- *   - false | First open stdout then stdin
+ * Make the fifo blocking again, once its peer has shown up
+ */
+static void fifo_block(int fd)
+{
+  int flags = fcntl(fd, F_GETFL);
+
+  if(flags != -1) fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+}
+
+/*
+ * Open fifos concurrently, and wait until every fifo has its peer
  *
- * RETURN (int status)
- * [IMPORTANT] Same as stdin_stdout_fifo_open
+ * Instead of blocking in open, in a fixed order, all fifos are opened without blocking.
+ * A reading end is ready when its writer has written or hung up,
+ * and a writing end is retried until the fifo has a reader
+ *
+ * Note: The fifos are left blocking, and the fifos without a path are skipped
  *
- * Note: This is a very nice programming concept
- *       I have never seen it being used before
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to open a fifo, or interrupted
  */
-int stdout_stdin_fifo_open(int* stdout_fifo, const char* stdout_path, int* stdin_fifo, const char* stdin_path, bool reverse, bool debug)
+int fifos_open(struct fifo_open* opens, int count, bool debug)
 {
-  if(reverse) return stdin_stdout_fifo_open(stdin_fifo, stdin_path, stdout_fifo, stdout_path, !reverse, debug);
+  bool ready[count];
 
-  int status = 0b00;
+  int waiting = 0;
 
-  if(stdout_path && stdout_fifo_open(stdout_fifo, stdout_path, debug) != 0)
+  for(int index = 0; index < count; index++)
   {
-    status |= (0b01 << 1);
+    ready[index] = (opens[index].path == NULL || *opens[index].fifo != -1);
+
+    if(!ready[index]) waiting++;
+
+    if(!ready[index] && debug) info_print("Opening fifo (%s)", opens[index].path);
   }
 
-  if(stdin_path && stdin_fifo_open(stdin_fifo, stdin_path, debug) != 0)
+  while(waiting > 0)
   {
-    status |= (0b01 << 0);
+    struct pollfd pollfds[count];
+
+    int indexes[count];
+
+    int poll_count = 0;
+
+    bool retry = false;
+
+    for(int index = 0; index < count; index++)
+    {
+      struct fifo_open* entry = &opens[index];
+
+      if(ready[index]) continue;
+
+      if(*entry->fifo == -1)
+      {
+        int status = fifo_open_nonblock(entry->fifo, entry->path, entry->flags, debug);
+
+        if(status == -1) return -1;
+
+        if(status == 1)
+        {
+          retry = true;
+
+          continue;
+        }
+
+        // The writing end is ready as soon as it is opened
+        if(entry->flags == O_WRONLY)
+        {
+          fifo_block(*entry->fifo);
+
+          ready[index] = true;
+
+          waiting--;
+
+          continue;
+        }
+      }
+
+      pollfds[poll_count] = (struct pollfd) { .fd = *entry->fifo, .events = POLLIN };
+
+      indexes[poll_count++] = index;
+    }
+
+    if(waiting == 0) break;
+
+    if(poll(pollfds, poll_count, retry ? FIFO_RETRY_INTERVAL : -1) == -1)
+    {
+      if(debug) error_print("Failed to wait for fifos: %s", strerror(errno));
+
+      return -1;
+    }
+
+    for(int index = 0; index < poll_count; index++)
+    {
+      if(!(pollfds[index].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+      fifo_block(pollfds[index].fd);
+
+      ready[indexes[index]] = true;
+
+      waiting--;
+    }
   }
 
-  return status;
+  return 0;
 }
 
 /*
- * SPECIAL
- * stdin and stdout fifo can be opened independently
+ * Close fifo and mark it as closed for future potential use
+ *
+ * Optionally print debug messages
  *
- * PARAMS
- * - bool reverse
- *   - true  | First open stdout then stdin
- *   - false | First open stdin then stdout
+ * Note: If no open fifo is supplied, nothing is done
  *
  * RETURN (int status)
- * - 01 | Failed to open stdin fifo
- * - 10 | Failed to open stdout fifo
+ * - 0 | Success
+ * - 1 | Failed to close stdin fifo
  */
-int stdin_stdout_fifo_open(int* stdin_fifo, const char* stdin_path, int* stdout_fifo, const char* stdout_path, bool reverse, bool debug)
+int fifo_close(int* fifo, bool debug)
 {
-  if(reverse) return stdout_stdin_fifo_open(stdout_fifo, stdout_path, stdin_fifo, stdin_path, !reverse, debug);
+  if(!fifo || *fifo == -1) return 0;
 
-  int status = 0b00;
+  if(debug) info_print("Closing fifo (%d)", *fifo);
 
-  if(stdin_path && stdin_fifo_open(stdin_fifo, stdin_path, debug) != 0)
+  if(*fifo < FIFO_PIPES && pipes[*fifo].path)
   {
-    status |= (0b01 << 0);
+    fifo_pipe_report(*fifo);
+
+    pipes[*fifo] = (struct fifo_pipe) { 0 };
   }
 
-  if(stdout_path && stdout_fifo_open(stdout_fifo, stdout_path, debug) != 0)
+  if(close(*fifo) == -1)
   {
-    status |= (0b01 << 1);
+    if(debug) error_print("Failed to close fifo: %s", strerror(errno));
+
+    return 1;
   }
 
-  return status;
+  if(debug) info_print("Closed fifo");
+
+  *fifo = -1;
+
+  return 0;
 }
 
 /*
+ * Read a chunk of bytes from a fifo, using a single read call
+ *
+ * This is the fill function of a reader, which frames the chunks into lines
+ *
  * RETURN (ssize_t size)
- * - >0 | Success! The length of the read buffer
+ * - >0 | Success! The length of the read chunk
  * -  0 | End of File
  * - -1 | Failed to read buffer
  */
@@ -194,50 +322,81 @@ ssize_t buffer_read(int fd, char* buffer, size_t size)
 
   if(!buffer) return 0;
 
-  char symbol = '\0';
-  ssize_t index;
+  ssize_t status = read(fd, buffer, size);
 
-  for(index = 0; index < size && symbol != '\n'; index++)
+  if(status == -1 || errno != 0) return -1; // ERROR
+
+  // The fill level is sampled when the read emptied a full buffer, and now and then
+  if(fd < FIFO_PIPES && pipes[fd].tuned && (++pipes[fd].calls % FIFO_SAMPLE == 0 || (size_t) status == size))
   {
-    ssize_t status = read(fd, &symbol, 1);
+    fifo_pipe_observe(fd, status + fifo_pipe_queued(fd));
+  }
 
-    if(status == -1 || errno != 0) return -1; // ERROR
+  return status;
+}
 
-    buffer[index] = symbol;
+/*
+ * Get the monotonic time, in microseconds
+ */
+static long fifo_time(void)
+{
+  struct timespec time;
 
-    if(status == 0) return 0; // End Of File
-  }
+  clock_gettime(CLOCK_MONOTONIC, &time);
 
-  return index;
+  return time.tv_sec * 1000000L + time.tv_nsec / 1000;
 }
 
 /*
+ * Write iovecs to a fifo, using a single writev call
+ *
+ * This is the flush function of a writer, which batches lines
+ *
  * RETURN (ssize_t size)
- * - >0 | Success! The length of the written buffer
+ * - >0 | Success! The number of written bytes
  * -  0 | End of File? (I think)
  * - -1 | Failed to write to buffer
  */
-ssize_t buffer_write(int fd, const char* buffer, size_t size)
+ssize_t buffer_write(int fd, const struct iovec* iovecs, int count)
 {
   if(errno != 0) return -1;
 
-  if(!buffer) return 0;
+  if(!iovecs) return 0;
 
-  ssize_t index;
-  char symbol = '\0';
+  struct fifo_pipe* tuning = (fd < FIFO_PIPES && pipes[fd].tuned) ? &pipes[fd] : NULL;
 
-  for(index = 0; index < size && symbol != '\n'; index++)
+  size_t length = 0;
+
+  long start = 0;
+
+  if(tuning)
   {
-    symbol = buffer[index];
+    for(int index = 0; index < count; index++) length += iovecs[index].iov_len;
+
+    // The fill level is sampled now and then, and after a write that hit a full pipe.
+    // A blocking write to a full pipe waits without returning early,
+    // so the pipe is grown before the write instead of after it
+    if(tuning->pressed || ++tuning->calls % FIFO_SAMPLE == 0)
+    {
+      fifo_pipe_observe(fd, fifo_pipe_queued(fd) + length);
+    }
+
+    start = fifo_time();
+  }
 
-    ssize_t status = write(fd, &symbol, 1);
+  ssize_t status = writev(fd, iovecs, count);
 
-    if(status == -1 || errno != 0) return -1;
+  // A full pipe either cuts the write short, or makes it wait,
+  // which says that the pipe was full without sampling it
+  if(tuning)
+  {
+    tuning->pressed = (status == -1) ? (errno == EAGAIN || errno == EWOULDBLOCK) :
+      ((size_t) status < length || fifo_time() - start >= FIFO_WRITE_SLOW);
 
-    if(status == 0) return 0; // End Of File
-    
-    if(symbol == '\0') break;
+    if(tuning->pressed) fifo_pipe_observe(fd, tuning->capacity);
   }
 
-  return index;
+  if(status == -1 || errno != 0) return -1; // ERROR
+
+  return status;
 }
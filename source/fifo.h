@@ -1,7 +1,7 @@
 /*
  * Written by Hampus Fridholm
  *
- * Last updated: 2024-09-08
+ * Last updated: 2026-10-15
  */
 
 #ifndef FIFO_H
@@ -15,14 +15,54 @@
 #include <errno.h>
 #include <string.h>
 #include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/uio.h>
+#include <sys/ioctl.h>
 
-extern int stdin_stdout_fifo_open(int* stdin_fifo, const char* stdin_path, int* stdout_fifo, const char* stdout_path, bool reverse, bool debug);
+#define FIFO_RETRY_INTERVAL 10 // Milliseconds between attempts to open a writing end
+
+#define FIFO_PIPES       1024 // File descriptors that can have their pipe capacity tuned
+#define FIFO_SAMPLE      64   // Calls between samples of the fill level of a tuned fifo
+#define FIFO_PIPE_MIN    4096 // The smallest pipe capacity, a page
+#define FIFO_WRITE_SLOW  1000 // Microseconds of a write that must have waited for a full fifo
+
+/*
+ * The pipe capacity of a fifo, grown with F_SETPIPE_SZ as the fifo fills up
+ */
+struct fifo_pipe
+{
+  const char* path;
+  int         capacity;
+  int         limit;
+  int         peak;
+  int         resizes;
+  size_t      calls;
+  bool        pressed;
+  bool        tuned;
+};
+
+/*
+ * A fifo to be opened, for reading (O_RDONLY) or for writing (O_WRONLY)
+ */
+struct fifo_open
+{
+  int*        fifo;
+  const char* path;
+  int         flags;
+};
+
+extern int fifo_open_nonblock(int* fifo, const char* path, int flags, bool debug);
+
+extern int fifos_open(struct fifo_open* opens, int count, bool debug);
 
 extern int fifo_close(int* fifo, bool debug);
 
+extern void fifo_pipe_limit_set(int limit);
+
 
 extern ssize_t buffer_read(int fd, char* buffer, size_t size);
 
-extern ssize_t buffer_write(int fd, const char* buffer, size_t size);
+extern ssize_t buffer_write(int fd, const struct iovec* iovecs, int count);
 
 #endif // FIFO_H
@@ -0,0 +1,28 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#include "frame.h"
+
+/*
+ * Store the payload length of a frame in its header
+ */
+void frame_header_encode(char* header, uint32_t length)
+{
+  header[0] = (length >> 24) & 0xff;
+  header[1] = (length >> 16) & 0xff;
+  header[2] = (length >>  8) & 0xff;
+  header[3] = (length >>  0) & 0xff;
+}
+
+/*
+ * Get the payload length of a frame from its header
+ */
+uint32_t frame_header_decode(const char* header)
+{
+  const unsigned char* bytes = (const unsigned char*) header;
+
+  return ((uint32_t) bytes[0] << 24) | ((uint32_t) bytes[1] << 16) | ((uint32_t) bytes[2] << 8) | (uint32_t) bytes[3];
+}
@@ -0,0 +1,20 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Every frame starts with its payload length, as a big endian 32-bit integer
+#define FRAME_HEADER_SIZE 4
+
+extern void     frame_header_encode(char* header, uint32_t length);
+
+extern uint32_t frame_header_decode(const char* header);
+
+#endif // FRAME_H
@@ -0,0 +1,143 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#include "histogram.h"
+
+/*
+ * Get the monotonic time, in nanoseconds
+ */
+long histogram_time(void)
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+
+  return time.tv_sec * 1000000000L + time.tv_nsec;
+}
+
+/*
+ * Get the bucket of a value
+ *
+ * The first two powers of two have a bucket per value,
+ * and the rest are split into HISTOGRAM_SUB_COUNT buckets each
+ */
+static size_t histogram_index(size_t value)
+{
+  if(value < 2 * HISTOGRAM_SUB_COUNT) return value;
+
+  int shift = (63 - __builtin_clzl(value)) - HISTOGRAM_SUB_BITS;
+
+  return HISTOGRAM_SUB_COUNT * (shift + 1) + ((value >> shift) - HISTOGRAM_SUB_COUNT);
+}
+
+/*
+ * Get the highest value of a bucket
+ */
+static size_t histogram_value(size_t index)
+{
+  if(index < 2 * HISTOGRAM_SUB_COUNT) return index;
+
+  int shift = index / HISTOGRAM_SUB_COUNT - 1;
+
+  size_t top = index % HISTOGRAM_SUB_COUNT + HISTOGRAM_SUB_COUNT;
+
+  return ((top + 1) << shift) - 1;
+}
+
+/*
+ * Record a value, clamped to the range of the histogram
+ *
+ * Only the owning thread records, so the count is a plain load and store,
+ * made atomic so that merging threads never read torn values
+ */
+void histogram_record(struct histogram* histogram, long value)
+{
+  size_t clamped = (value < 0) ? 0 : (size_t) value;
+
+  if(clamped >= (1UL << HISTOGRAM_MAX_BITS)) clamped = (1UL << HISTOGRAM_MAX_BITS) - 1;
+
+  size_t index = histogram_index(clamped);
+
+  __atomic_store_n(&histogram->counts[index], histogram->counts[index] + 1, __ATOMIC_RELAXED);
+
+  __atomic_store_n(&histogram->count, histogram->count + 1, __ATOMIC_RELAXED);
+
+  if(clamped > histogram->max) __atomic_store_n(&histogram->max, clamped, __ATOMIC_RELAXED);
+}
+
+/*
+ * Add the counts of source to dest
+ *
+ * The source can be recorded into while it is merged,
+ * which is how a snapshot of a live histogram is taken
+ */
+void histogram_merge(struct histogram* dest, const struct histogram* source)
+{
+  size_t count = 0;
+
+  for(size_t index = 0; index < HISTOGRAM_BUCKETS; index++)
+  {
+    size_t bucket = __atomic_load_n(&source->counts[index], __ATOMIC_RELAXED);
+
+    dest->counts[index] += bucket;
+
+    count += bucket;
+  }
+
+  // The count is summed from the buckets, to be consistent with them
+  dest->count += count;
+
+  size_t max = __atomic_load_n(&source->max, __ATOMIC_RELAXED);
+
+  if(max > dest->max) dest->max = max;
+}
+
+/*
+ * Get the value at a percentile, between 0 and 100
+ *
+ * RETURN (size_t value)
+ * - The highest value of the bucket of the percentile, or 0 if empty
+ */
+size_t histogram_percentile(const struct histogram* histogram, double percentile)
+{
+  if(histogram->count == 0) return 0;
+
+  size_t rank = (size_t) (percentile / 100 * histogram->count);
+
+  if(rank >= histogram->count) rank = histogram->count - 1;
+
+  size_t seen = 0;
+
+  for(size_t index = 0; index < HISTOGRAM_BUCKETS; index++)
+  {
+    seen += histogram->counts[index];
+
+    if(seen > rank)
+    {
+      size_t value = histogram_value(index);
+
+      return (value < histogram->max) ? value : histogram->max;
+    }
+  }
+
+  return histogram->max;
+}
+
+/*
+ * Print the percentiles of a histogram to stderr, in microseconds
+ */
+void histogram_print(const char* name, const struct histogram* histogram)
+{
+  if(histogram->count == 0) return;
+
+  log_print(stderr, "LATENCY", "%s %ld samples, p50 %f us, p90 %f us, p99 %f us, p99.9 %f us, max %f us",
+    name, (long) histogram->count,
+    histogram_percentile(histogram, 50)   / 1e3,
+    histogram_percentile(histogram, 90)   / 1e3,
+    histogram_percentile(histogram, 99)   / 1e3,
+    histogram_percentile(histogram, 99.9) / 1e3,
+    histogram->max / 1e3);
+}
@@ -0,0 +1,50 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "debug.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define HISTOGRAM_SUB_BITS 5  // 32 buckets per power of two, about 3% precision
+#define HISTOGRAM_MAX_BITS 40 // Values up to about 18 minutes, in nanoseconds
+#define HISTOGRAM_ALIGN    64
+
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS   (HISTOGRAM_SUB_COUNT * (HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1))
+
+/*
+ * Log-linear (HDR-style) histogram of durations, in nanoseconds
+ *
+ * Every power of two is split into linear buckets, so the relative
+ * precision is the same for short and long durations
+ *
+ * A histogram is recorded into by only one thread, without locks,
+ * and other threads read it by merging it into a histogram of their own
+ */
+struct histogram
+{
+  size_t counts[HISTOGRAM_BUCKETS];
+  size_t count;
+  size_t max;
+} __attribute__((aligned(HISTOGRAM_ALIGN)));
+
+extern long   histogram_time(void);
+
+extern void   histogram_record(struct histogram* histogram, long value);
+
+extern void   histogram_merge(struct histogram* dest, const struct histogram* source);
+
+extern size_t histogram_percentile(const struct histogram* histogram, double percentile);
+
+extern void   histogram_print(const char* name, const struct histogram* histogram);
+
+#endif // HISTOGRAM_H
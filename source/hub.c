@@ -0,0 +1,1019 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#define _GNU_SOURCE
+
+#include "hub.h"
+
+// Event tokens of the listening socket, the input and the output,
+// the clients use their slot index offset by HUB_TOKEN_CLIENT
+#define HUB_TOKEN_SERVER 0
+#define HUB_TOKEN_INPUT  1
+#define HUB_TOKEN_OUTPUT 2
+#define HUB_TOKEN_CLIENT 3
+
+/*
+ * A line that is longer than the receive buffer, collected until its newline arrives,
+ * so that only complete lines are broadcast
+ *
+ * A line that is longer than HUB_LINE_SIZE is dropped, up to its newline
+ */
+struct partial
+{
+  char*  buffer;
+  size_t length;
+  bool   dropped;
+};
+
+/*
+ * A client connected to the hub, with its own outbound queue
+ */
+struct client
+{
+  int           fd;
+  struct reader reader;
+  struct writer writer;
+  struct partial partial;
+  bool          writable;
+  bool          dirty;
+  bool          closing;
+  char**        topics;
+  int           topic_count;
+  int           topic_capacity;
+  size_t        generation;
+};
+
+/*
+ * The hub - accepts any number of clients,
+ * and broadcasts every line to all other clients
+ */
+struct hub
+{
+  int             epollfd;
+  int             servfd;
+  struct client** clients;
+  int*            frees;
+  int*            dirties;
+  int*            closings;
+  int             capacity;
+  int             free_count;
+  int             dirty_count;
+  int             closing_count;
+  int             count;
+  bool            input_open;
+  struct reader   input;
+  struct partial  input_partial;
+  struct writer   output;
+  bool            output_open;
+  bool            output_writable;
+  bool            output_backlog;
+  size_t          output_drops;
+  size_t          lines;
+  struct trie_node* topics;
+  size_t          generation;
+  bool            debug;
+};
+
+/*
+ * A line being routed to the subscribers of its topic
+ */
+struct route
+{
+  struct hub* hub;
+  int         from;
+  const char* line;
+  size_t      length;
+};
+
+/*
+ * Raise the limit of open files to the hard limit,
+ * to be able to accept thousands of clients
+ */
+static void hub_files_limit_raise(bool debug)
+{
+  struct rlimit limit;
+
+  if(getrlimit(RLIMIT_NOFILE, &limit) == -1) return;
+
+  limit.rlim_cur = limit.rlim_max;
+
+  if(setrlimit(RLIMIT_NOFILE, &limit) == 0)
+  {
+    if(debug) info_print("Raised open files limit to %ld", (long) limit.rlim_cur);
+  }
+}
+
+/*
+ * Add file descriptor to the event loop of the hub, with a token
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to add file descriptor
+ */
+static int hub_fd_add(struct hub* hub, int fd, uint32_t events, uint64_t token)
+{
+  struct epoll_event event = { .events = events, .data.u64 = token };
+
+  return epoll_ctl(hub->epollfd, EPOLL_CTL_ADD, fd, &event);
+}
+
+/*
+ * Double the number of client slots
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to allocate slots
+ */
+static int hub_slots_grow(struct hub* hub)
+{
+  int capacity = (hub->capacity > 0) ? hub->capacity * 2 : 64;
+
+  struct client** clients = realloc(hub->clients, sizeof(struct client*) * capacity);
+
+  if(!clients) return -1;
+
+  hub->clients = clients;
+
+  int* frees = realloc(hub->frees, sizeof(int) * capacity);
+
+  if(!frees) return -1;
+
+  hub->frees = frees;
+
+  int* dirties = realloc(hub->dirties, sizeof(int) * capacity);
+
+  if(!dirties) return -1;
+
+  hub->dirties = dirties;
+
+  int* closings = realloc(hub->closings, sizeof(int) * capacity);
+
+  if(!closings) return -1;
+
+  hub->closings = closings;
+
+  // Push the new slots in reverse, so the lowest slot is used first
+  for(int slot = capacity - 1; slot >= hub->capacity; slot--)
+  {
+    hub->clients[slot] = NULL;
+
+    hub->frees[hub->free_count++] = slot;
+  }
+
+  hub->capacity = capacity;
+
+  return 0;
+}
+
+/*
+ * Free the buffers of a client and close its socket
+ */
+static void client_free(struct client* client)
+{
+  for(int index = 0; index < client->topic_count; index++)
+  {
+    free(client->topics[index]);
+  }
+
+  free(client->topics);
+
+  pool_release(client->partial.buffer);
+
+  reader_free(&client->reader);
+
+  writer_free(&client->writer);
+
+  close(client->fd);
+
+  pool_release(client);
+}
+
+/*
+ * Add an accepted client to a free slot of the hub
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to add client
+ */
+static int hub_client_add(struct hub* hub, int fd)
+{
+  if(hub->free_count == 0 && hub_slots_grow(hub) == -1) return -1;
+
+  struct client* client = pool_alloc(sizeof(struct client));
+
+  if(!client) return -1;
+
+  client->fd       = fd;
+  client->writable = true;
+  client->dirty    = false;
+  client->closing  = false;
+
+  client->partial = (struct partial) { 0 };
+
+  client->topics         = NULL;
+  client->topic_count    = 0;
+  client->topic_capacity = 0;
+  client->generation     = 0;
+
+  if(reader_init(&client->reader, fd, socket_read, HUB_READER_SIZE) == -1)
+  {
+    pool_release(client);
+
+    return -1;
+  }
+
+  if(writer_init(&client->writer, fd, socket_write, HUB_WRITER_SIZE) == -1)
+  {
+    reader_free(&client->reader);
+
+    pool_release(client);
+
+    return -1;
+  }
+
+  int slot = hub->frees[--hub->free_count];
+
+  if(hub_fd_add(hub, fd, EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP, HUB_TOKEN_CLIENT + slot) == -1)
+  {
+    hub->frees[hub->free_count++] = slot;
+
+    reader_free(&client->reader);
+
+    writer_free(&client->writer);
+
+    pool_release(client);
+
+    return -1;
+  }
+
+  hub->clients[slot] = client;
+
+  hub->count++;
+
+  if(hub->debug) info_print("Hub client (%d) connected, %d clients", fd, hub->count);
+
+  return 0;
+}
+
+/*
+ * Remove a client from the hub, and free its slot
+ */
+static void hub_client_remove(struct hub* hub, int slot)
+{
+  struct client* client = hub->clients[slot];
+
+  epoll_ctl(hub->epollfd, EPOLL_CTL_DEL, client->fd, NULL);
+
+  for(int index = 0; index < client->topic_count; index++)
+  {
+    trie_remove(hub->topics, client->topics[index], strlen(client->topics[index]), slot);
+  }
+
+  hub->clients[slot] = NULL;
+
+  hub->frees[hub->free_count++] = slot;
+
+  hub->count--;
+
+  if(hub->debug) info_print("Hub client (%d) disconnected, %d clients", client->fd, hub->count);
+
+  client_free(client);
+}
+
+/*
+ * Accept all clients waiting to connect
+ */
+static void hub_clients_accept(struct hub* hub)
+{
+  int fd;
+
+  while((fd = accept4(hub->servfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1)
+  {
+    if(hub_client_add(hub, fd) == -1)
+    {
+      if(hub->debug) error_print("Failed to add hub client (%d)", fd);
+
+      close(fd);
+    }
+  }
+
+  errno = 0;
+}
+
+/*
+ * Mark a client to be removed, after the current batch of events
+ */
+static void hub_client_close(struct hub* hub, int slot)
+{
+  struct client* client = hub->clients[slot];
+
+  if(client->closing) return;
+
+  client->closing = true;
+
+  hub->closings[hub->closing_count++] = slot;
+}
+
+/*
+ * Queue a line to a client, without blocking
+ *
+ * A client whose queue is full is too slow to keep up,
+ * and is disconnected instead of stalling the other clients
+ */
+static void hub_client_queue(struct hub* hub, int slot, const char* line, size_t length)
+{
+  struct client* client = hub->clients[slot];
+
+  if(client->closing) return;
+
+  struct writer* writer = &client->writer;
+
+  if(writer->size - writer->end < length)
+  {
+    if(client->writable && writer_flush_nonblock(writer) == -1)
+    {
+      errno = 0;
+
+      hub_client_close(hub, slot);
+
+      return;
+    }
+
+    if(writer->size - writer->end < length)
+    {
+      if(hub->debug) error_print("Hub client (%d) is too slow, disconnecting", client->fd);
+
+      hub_client_close(hub, slot);
+
+      return;
+    }
+  }
+
+  writer_line_write(writer, line, length);
+
+  if(!client->dirty)
+  {
+    client->dirty = true;
+
+    hub->dirties[hub->dirty_count++] = slot;
+  }
+}
+
+/*
+ * Queue a routed line to a subscriber, once per line,
+ * even if several of its topics match
+ */
+static void hub_route_match(int slot, void* arg)
+{
+  struct route* route = arg;
+
+  struct hub* hub = route->hub;
+
+  struct client* client = hub->clients[slot];
+
+  if(slot == route->from || !client || client->generation == hub->generation) return;
+
+  client->generation = hub->generation;
+
+  hub_client_queue(hub, slot, route->line, route->length);
+}
+
+/*
+ * Get the length of the topic of a line, the first word of the line
+ */
+static size_t line_topic_length(const char* line, size_t length)
+{
+  size_t index;
+
+  for(index = 0; index < length && line[index] != ' ' && line[index] != '\n'; index++);
+
+  return index;
+}
+
+/*
+ * Route a line to the clients subscribed to a prefix of its topic
+ */
+static void hub_line_route(struct hub* hub, int from, const char* line, size_t length)
+{
+  struct route route = { .hub = hub, .from = from, .line = line, .length = length };
+
+  hub->generation++;
+
+  trie_prefixes_match(hub->topics, line, line_topic_length(line, length), hub_route_match, &route);
+}
+
+/*
+ * Subscribe a client to a topic, and remember it for the disconnect
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to subscribe
+ */
+static int hub_client_subscribe(struct hub* hub, int slot, const char* topic, size_t length)
+{
+  struct client* client = hub->clients[slot];
+
+  int status = trie_insert(hub->topics, topic, length, slot);
+
+  if(status != 0) return (status == 1) ? 0 : -1;
+
+  if(client->topic_count == client->topic_capacity)
+  {
+    int capacity = (client->topic_capacity > 0) ? client->topic_capacity * 2 : 4;
+
+    char** topics = realloc(client->topics, sizeof(char*) * capacity);
+
+    if(!topics)
+    {
+      trie_remove(hub->topics, topic, length, slot);
+
+      return -1;
+    }
+
+    client->topics         = topics;
+    client->topic_capacity = capacity;
+  }
+
+  char* copy = strndup(topic, length);
+
+  if(!copy)
+  {
+    trie_remove(hub->topics, topic, length, slot);
+
+    return -1;
+  }
+
+  client->topics[client->topic_count++] = copy;
+
+  if(hub->debug) info_print("Hub client (%d) subscribed to (%s)", client->fd, client->topics[client->topic_count - 1]);
+
+  return 0;
+}
+
+/*
+ * Unsubscribe a client from a topic
+ */
+static void hub_client_unsubscribe(struct hub* hub, int slot, const char* topic, size_t length)
+{
+  struct client* client = hub->clients[slot];
+
+  if(trie_remove(hub->topics, topic, length, slot) != 0) return;
+
+  for(int index = 0; index < client->topic_count; index++)
+  {
+    if(strlen(client->topics[index]) == length && !strncmp(client->topics[index], topic, length))
+    {
+      if(hub->debug) info_print("Hub client (%d) unsubscribed from (%s)", client->fd, client->topics[index]);
+
+      free(client->topics[index]);
+
+      client->topics[index] = client->topics[--client->topic_count];
+
+      break;
+    }
+  }
+}
+
+/*
+ * Handle a subscribe or unsubscribe control message from a client
+ *
+ * RETURN (bool control)
+ * - true  | The line was a control message
+ * - false | The line is a normal line
+ */
+static bool hub_control_handle(struct hub* hub, int slot, const char* line, size_t length)
+{
+  // The newline is not part of the topic
+  if(length > 0 && line[length - 1] == '\n') length--;
+
+  size_t sub_length   = strlen(HUB_SUBSCRIBE);
+  size_t unsub_length = strlen(HUB_UNSUBSCRIBE);
+
+  if(length >= sub_length && !strncmp(line, HUB_SUBSCRIBE, sub_length))
+  {
+    if(hub_client_subscribe(hub, slot, line + sub_length, length - sub_length) == -1)
+    {
+      if(hub->debug) error_print("Failed to subscribe hub client (%d)", hub->clients[slot]->fd);
+    }
+
+    return true;
+  }
+
+  if(length >= unsub_length && !strncmp(line, HUB_UNSUBSCRIBE, unsub_length))
+  {
+    hub_client_unsubscribe(hub, slot, line + unsub_length, length - unsub_length);
+
+    return true;
+  }
+
+  return false;
+}
+
+/*
+ * Send the queued lines of the output, without blocking
+ *
+ * If the output is gone, nothing more is queued to it
+ */
+static void hub_output_flush(struct hub* hub)
+{
+  if(!hub->output_open || !hub->output_writable) return;
+
+  int status = writer_flush_nonblock(&hub->output);
+
+  if(status == -1)
+  {
+    if(hub->debug) error_print("Hub output is closed");
+
+    hub->output_open = false;
+  }
+
+  if(status == 1) hub->output_writable = false;
+
+  errno = 0;
+}
+
+/*
+ * Queue a line to the output, without blocking
+ *
+ * The output is bounded by its queue, a line that doesn't fit while
+ * the output is backed up is dropped instead of stalling the clients
+ */
+static void hub_output_queue(struct hub* hub, const char* line, size_t length)
+{
+  if(!hub->output_open) return;
+
+  struct writer* writer = &hub->output;
+
+  if(writer->size - writer->end < length) hub_output_flush(hub);
+
+  if(!hub->output_open) return;
+
+  if(writer->size - writer->end < length)
+  {
+    if(hub->debug && !hub->output_backlog) error_print("Hub output is too slow, dropping lines");
+
+    hub->output_backlog = true;
+
+    hub->output_drops++;
+
+    return;
+  }
+
+  hub->output_backlog = false;
+
+  writer_line_write(writer, line, length);
+}
+
+/*
+ * Broadcast a line to all clients except the sender,
+ * and to the output if the line came from a client
+ *
+ * In topics mode, the line is only routed to subscribed clients
+ *
+ * PARAMS
+ * - int from | Slot of the sending client, or -1 for the input
+ */
+static void hub_line_broadcast(struct hub* hub, int from, const char* line, size_t length)
+{
+  hub->lines++;
+
+  // In topics mode, only the subscribers of the topic get the line
+  if(hub->topics) hub_line_route(hub, from, line, length);
+
+  else for(int slot = 0; slot < hub->capacity; slot++)
+  {
+    if(slot != from && hub->clients[slot]) hub_client_queue(hub, slot, line, length);
+  }
+
+  if(from != -1) hub_output_queue(hub, line, length);
+}
+
+/*
+ * Handle a complete line from a client or from the input,
+ * which is either a control message or a line to broadcast
+ *
+ * PARAMS
+ * - int from | Slot of the sending client, or -1 for the input
+ */
+static void hub_line_handle(struct hub* hub, int from, const char* line, size_t length)
+{
+  if(from != -1 && hub->topics && hub_control_handle(hub, from, line, length)) return;
+
+  hub_line_broadcast(hub, from, line, length);
+}
+
+/*
+ * Add a part of a line to the partial line
+ *
+ * The buffer is taken from the message pool for as long as the line is collected
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | The line is too long, or the buffer can't be allocated
+ */
+static int partial_append(struct partial* partial, const char* bytes, size_t length)
+{
+  if(partial->length + length > HUB_LINE_SIZE) return -1;
+
+  if(!partial->buffer && !(partial->buffer = pool_alloc(HUB_LINE_SIZE))) return -1;
+
+  memcpy(partial->buffer + partial->length, bytes, length);
+
+  partial->length += length;
+
+  return 0;
+}
+
+/*
+ * Empty the partial line, and give its buffer back to the message pool
+ */
+static void partial_reset(struct partial* partial)
+{
+  pool_release(partial->buffer);
+
+  partial->buffer = NULL;
+  partial->length = 0;
+}
+
+/*
+ * Handle the complete lines of a chunk, one at a time
+ *
+ * A line that doesn't end in the chunk is collected in the partial line of the sender,
+ * and is handled once its newline arrives, so that the parts of a line are never
+ * split up by the lines of other senders, or routed by their own first word
+ *
+ * PARAMS
+ * - int from | Slot of the sending client, or -1 for the input
+ */
+static void hub_chunk_handle(struct hub* hub, int from, struct partial* partial, const char* chunk, size_t size)
+{
+  const char* end = chunk + size;
+
+  for(const char* line = chunk; line < end; )
+  {
+    const char* newline = memchr(line, '\n', end - line);
+
+    size_t length = newline ? (size_t) (newline - line) + 1 : (size_t) (end - line);
+
+    if(partial->dropped)
+    {
+      if(newline) partial->dropped = false;
+    }
+    // The line is complete in the chunk, and is handled without copying
+    else if(newline && partial->length == 0)
+    {
+      hub_line_handle(hub, from, line, length);
+    }
+    else if(partial_append(partial, line, length) == -1)
+    {
+      if(hub->debug) error_print("Dropped a line of more than %d bytes", HUB_LINE_SIZE);
+
+      partial_reset(partial);
+
+      partial->dropped = !newline;
+    }
+    else if(newline)
+    {
+      hub_line_handle(hub, from, partial->buffer, partial->length);
+
+      partial_reset(partial);
+    }
+
+    line += length;
+  }
+}
+
+/*
+ * Read all available lines from a client and broadcast them
+ *
+ * The lines are handed out straight from the receive buffer,
+ * which only hands out a partial line when it is full, or at the end of file
+ */
+static void hub_client_read(struct hub* hub, int slot)
+{
+  struct client* client = hub->clients[slot];
+
+  const char* lines;
+
+  ssize_t read_size;
+
+  while(!client->closing && (read_size = reader_lines_read(&client->reader, &lines, client->reader.size)) > 0)
+  {
+    hub_chunk_handle(hub, slot, &client->partial, lines, read_size);
+  }
+
+  if(client->closing) return;
+
+  // End of file, or an error other than no more bytes to read
+  if(read_size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+  {
+    hub_client_close(hub, slot);
+  }
+
+  errno = 0;
+}
+
+/*
+ * Read all available lines from the input and broadcast them to all clients
+ */
+static void hub_input_read(struct hub* hub)
+{
+  const char* lines;
+
+  ssize_t read_size;
+
+  while((read_size = reader_lines_read(&hub->input, &lines, hub->input.size)) > 0)
+  {
+    hub_chunk_handle(hub, -1, &hub->input_partial, lines, read_size);
+  }
+
+  // The hub keeps running for the clients, when the input is closed
+  if(read_size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+  {
+    if(hub->debug) info_print("Hub input (%d) closed", hub->input.fd);
+
+    // The last line has no newline, and would be joined with the next line of the clients
+    if(hub->input_partial.length > 0)
+    {
+      if(hub->debug) error_print("Dropped the unterminated last line of the input");
+
+      partial_reset(&hub->input_partial);
+    }
+
+    epoll_ctl(hub->epollfd, EPOLL_CTL_DEL, hub->input.fd, NULL);
+
+    hub->input_open = false;
+  }
+
+  errno = 0;
+}
+
+/*
+ * Send the queued lines of all clients with new lines, and of the output,
+ * one syscall per client for the whole batch of events
+ */
+static void hub_clients_flush(struct hub* hub)
+{
+  for(int index = 0; index < hub->dirty_count; index++)
+  {
+    int slot = hub->dirties[index];
+
+    struct client* client = hub->clients[slot];
+
+    if(!client) continue;
+
+    client->dirty = false;
+
+    if(client->closing || !client->writable) continue;
+
+    int status = writer_flush_nonblock(&client->writer);
+
+    if(status == -1) hub_client_close(hub, slot);
+
+    if(status == 1) client->writable = false;
+
+    errno = 0;
+  }
+
+  hub->dirty_count = 0;
+
+  if(writer_pending(&hub->output)) hub_output_flush(hub);
+}
+
+/*
+ * Remove all clients that were disconnected or too slow
+ */
+static void hub_clients_close(struct hub* hub)
+{
+  for(int index = 0; index < hub->closing_count; index++)
+  {
+    hub_client_remove(hub, hub->closings[index]);
+  }
+
+  hub->closing_count = 0;
+}
+
+/*
+ * Handle a single event of the hub
+ */
+static void hub_event_handle(struct hub* hub, struct epoll_event* event)
+{
+  if(event->data.u64 == HUB_TOKEN_SERVER)
+  {
+    hub_clients_accept(hub);
+
+    return;
+  }
+
+  if(event->data.u64 == HUB_TOKEN_INPUT)
+  {
+    hub_input_read(hub);
+
+    return;
+  }
+
+  if(event->data.u64 == HUB_TOKEN_OUTPUT)
+  {
+    hub->output_writable = true;
+
+    if(event->events & (EPOLLHUP | EPOLLERR))
+    {
+      if(hub->debug && hub->output_open) error_print("Hub output is closed");
+
+      hub->output_open = false;
+    }
+
+    hub_output_flush(hub);
+
+    return;
+  }
+
+  int slot = event->data.u64 - HUB_TOKEN_CLIENT;
+
+  struct client* client = hub->clients[slot];
+
+  if(!client || client->closing) return;
+
+  if(event->events & EPOLLOUT)
+  {
+    client->writable = true;
+
+    if(writer_pending(&client->writer))
+    {
+      int status = writer_flush_nonblock(&client->writer);
+
+      if(status == -1) hub_client_close(hub, slot);
+
+      if(status == 1) client->writable = false;
+
+      errno = 0;
+    }
+  }
+
+  if(event->events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+  {
+    hub_client_read(hub, slot);
+  }
+}
+
+/*
+ * Free everything of the hub, and disconnect all clients
+ */
+static void hub_free(struct hub* hub)
+{
+  for(int slot = 0; slot < hub->capacity; slot++)
+  {
+    if(hub->clients[slot]) client_free(hub->clients[slot]);
+  }
+
+  free(hub->clients);
+
+  free(hub->frees);
+
+  free(hub->dirties);
+
+  free(hub->closings);
+
+  trie_free(hub->topics);
+
+  pool_release(hub->input_partial.buffer);
+
+  reader_free(&hub->input);
+
+  writer_free(&hub->output);
+
+  event_loop_close(&hub->epollfd, hub->debug);
+}
+
+/*
+ * Initialize the hub, with the listening socket, the input and the output
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to initialize hub
+ */
+static int hub_init(struct hub* hub, int servfd, int in_fd, int out_fd, bool topics, bool debug)
+{
+  memset(hub, 0, sizeof(struct hub));
+
+  hub->servfd          = servfd;
+  hub->debug           = debug;
+  hub->input_open      = true;
+  hub->output_open     = true;
+  hub->output_writable = true;
+
+  if((hub->epollfd = event_loop_create(debug)) == -1) return -1;
+
+  if(reader_init(&hub->input, in_fd, buffer_read, READER_SIZE) == -1)
+  {
+    event_loop_close(&hub->epollfd, debug);
+
+    return -1;
+  }
+
+  if(writer_init(&hub->output, out_fd, buffer_write, WRITER_SIZE) == -1)
+  {
+    reader_free(&hub->input);
+
+    event_loop_close(&hub->epollfd, debug);
+
+    return -1;
+  }
+
+  if(hub_slots_grow(hub) == -1 || (topics && !(hub->topics = trie_create())))
+  {
+    hub_free(hub);
+
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * Run the hub - accept any number of clients, and broadcast every line
+ * from a client or from the input to all other clients
+ *
+ * Lines from clients are also written to the output.
+ * Every client, and the output, has its own non-blocking queue,
+ * so a slow client or a slow output doesn't block the others
+ *
+ * In topics mode, clients subscribe to topics with control messages,
+ * and only get the lines whose topic (first word) starts with a subscribed topic
+ *
+ * RETURN (int status)
+ * - 0 | Success, interrupted
+ * - 1 | Failed to initialize hub
+ * - 2 | Failed to wait for events
+ */
+int hub_run(int servfd, int in_fd, int out_fd, bool topics, bool debug)
+{
+  struct hub hub;
+
+  hub_files_limit_raise(debug);
+
+  if(hub_init(&hub, servfd, in_fd, out_fd, topics, debug) == -1) return 1;
+
+  event_fd_nonblock(servfd);
+
+  int in_flags = event_fd_nonblock(in_fd);
+
+  int out_flags = event_fd_nonblock(out_fd);
+
+  hub_fd_add(&hub, servfd, EPOLLIN, HUB_TOKEN_SERVER);
+
+  // Regular files can't be added, but they never block
+  if(hub_fd_add(&hub, in_fd, EPOLLIN | EPOLLET, HUB_TOKEN_INPUT) == -1) hub_input_read(&hub);
+
+  if(hub_fd_add(&hub, out_fd, EPOLLOUT | EPOLLET, HUB_TOKEN_OUTPUT) == -1) errno = 0;
+
+  if(debug) info_print("Start of hub");
+
+  int status = 0;
+
+  struct epoll_event events[EVENT_COUNT];
+
+  while(true)
+  {
+    int event_count = epoll_wait(hub.epollfd, events, EVENT_COUNT, -1);
+
+    if(event_count == -1)
+    {
+      if(errno != EINTR) status = 2;
+
+      break;
+    }
+
+    for(int index = 0; index < event_count; index++)
+    {
+      hub_event_handle(&hub, &events[index]);
+    }
+
+    hub_clients_flush(&hub);
+
+    hub_clients_close(&hub);
+  }
+
+  if(debug) info_print("End of hub, broadcasted %ld lines", (long) hub.lines);
+
+  // Send what the output can still take, without waiting for it
+  errno = 0;
+
+  hub.output_writable = true;
+
+  hub_output_flush(&hub);
+
+  if(debug && hub.output_drops) error_print("Hub output dropped %ld lines", (long) hub.output_drops);
+
+  // In reverse order, the input and the output might share their flags
+  if(out_flags != -1) fcntl(out_fd, F_SETFL, out_flags);
+
+  if(in_flags != -1) fcntl(in_fd, F_SETFL, in_flags);
+
+  hub_free(&hub);
+
+  return status;
+}
@@ -0,0 +1,40 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef HUB_H
+#define HUB_H
+
+#include "debug.h"
+#include "event.h"
+#include "reader.h"
+#include "writer.h"
+#include "socket.h"
+#include "fifo.h"
+#include "trie.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#define HUB_READER_SIZE 16384
+#define HUB_WRITER_SIZE 65536
+#define HUB_POOL_CLIENTS 256 // Clients with preallocated buffers in the message pool
+#define HUB_POOL_PARTIALS 8  // Long lines that are collected at the same time, in the message pool
+#define HUB_LINE_SIZE   HUB_WRITER_SIZE // The longest line, it has to fit in the queue of a client
+
+// Control messages of clients in topics mode, followed by the topic
+#define HUB_SUBSCRIBE   "/sub "
+#define HUB_UNSUBSCRIBE "/unsub "
+
+extern int hub_run(int servfd, int in_fd, int out_fd, bool topics, bool debug);
+
+#endif // HUB_H
@@ -0,0 +1,235 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#include "lz4.h"
+
+/*
+ * Block compressor, producing the LZ4 block format
+ *
+ * A block is a list of sequences, where every sequence is:
+ * - a token, with the literal length and the match length in 4 bits each
+ * - extra bytes of the literal length, if it is 15 or more
+ * - the literals
+ * - the offset of the match, in 2 bytes (little endian)
+ * - extra bytes of the match length, if it is 19 or more
+ *
+ * The last sequence only has literals
+ */
+
+#define LZ4_HASH_BITS  12
+#define LZ4_MIN_MATCH  4
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_MF_LIMIT   12 // The last match starts at least this far from the end
+#define LZ4_LAST_BYTES 5  // The last bytes are always literals
+
+static inline uint32_t lz4_read32(const char* pointer)
+{
+  uint32_t value;
+
+  memcpy(&value, pointer, sizeof(value));
+
+  return value;
+}
+
+static inline uint32_t lz4_hash(uint32_t sequence)
+{
+  return (sequence * 2654435761U) >> (32 - LZ4_HASH_BITS);
+}
+
+/*
+ * Write a length that doesn't fit in the 4 bits of the token
+ */
+static char* lz4_length_write(char* dest, size_t length)
+{
+  for(; length >= 255; length -= 255) *dest++ = (char) 255;
+
+  *dest++ = (char) length;
+
+  return dest;
+}
+
+/*
+ * Write a sequence of literals, followed by a match if match_length > 0
+ *
+ * RETURN (char* dest)
+ * - !NULL | Success! The end of the written sequence
+ * -  NULL | The sequence doesn't fit in dest
+ */
+static char* lz4_sequence_write(char* dest, const char* end, const char* literals, size_t literal_length, size_t offset, size_t match_length)
+{
+  if(dest + 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1 > end) return NULL;
+
+  char* token = dest++;
+
+  size_t match_code = (match_length > 0) ? match_length - LZ4_MIN_MATCH : 0;
+
+  *token = (char) (((literal_length < 15) ? literal_length : 15) << 4);
+
+  if(literal_length >= 15) dest = lz4_length_write(dest, literal_length - 15);
+
+  memcpy(dest, literals, literal_length);
+
+  dest += literal_length;
+
+  if(match_length == 0) return dest;
+
+  *dest++ = (char) (offset & 0xff);
+  *dest++ = (char) (offset >> 8);
+
+  *token |= (char) ((match_code < 15) ? match_code : 15);
+
+  if(match_code >= 15) dest = lz4_length_write(dest, match_code - 15);
+
+  return dest;
+}
+
+/*
+ * Compress a block of bytes
+ *
+ * RETURN (size_t size)
+ * - >0 | Success! The size of the compressed block
+ * -  0 | The compressed block doesn't fit in dest
+ */
+size_t lz4_compress(const char* source, size_t length, char* dest, size_t capacity)
+{
+  uint32_t table[1 << LZ4_HASH_BITS] = { 0 };
+
+  const char* end      = source + length;
+  const char* limit    = (length > LZ4_MF_LIMIT) ? end - LZ4_MF_LIMIT : source;
+  const char* anchor   = source;
+  const char* pointer  = source + 1;
+
+  char* output     = dest;
+  char* output_end = dest + capacity;
+
+  while(pointer < limit)
+  {
+    uint32_t sequence = lz4_read32(pointer);
+
+    uint32_t hash = lz4_hash(sequence);
+
+    const char* match = source + table[hash];
+
+    table[hash] = pointer - source;
+
+    if(match >= pointer || pointer - match > LZ4_MAX_OFFSET || lz4_read32(match) != sequence)
+    {
+      pointer++;
+
+      continue;
+    }
+
+    // Extend the match backwards over the literals, and forwards
+    while(pointer > anchor && match > source && pointer[-1] == match[-1])
+    {
+      pointer--;
+      match--;
+    }
+
+    size_t match_length = LZ4_MIN_MATCH;
+
+    while(pointer + match_length < end - LZ4_LAST_BYTES && pointer[match_length] == match[match_length])
+    {
+      match_length++;
+    }
+
+    output = lz4_sequence_write(output, output_end, anchor, pointer - anchor, pointer - match, match_length);
+
+    if(!output) return 0;
+
+    pointer += match_length;
+
+    anchor = pointer;
+  }
+
+  output = lz4_sequence_write(output, output_end, anchor, end - anchor, 0, 0);
+
+  if(!output) return 0;
+
+  return output - dest;
+}
+
+/*
+ * Read a length that doesn't fit in the 4 bits of the token
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | The block ends within the length
+ */
+static int lz4_length_read(const unsigned char** source, const unsigned char* end, size_t* length)
+{
+  unsigned char byte;
+
+  do
+  {
+    if(*source >= end) return -1;
+
+    byte = *(*source)++;
+
+    *length += byte;
+  }
+  while(byte == 255);
+
+  return 0;
+}
+
+/*
+ * Decompress a block of bytes
+ *
+ * RETURN (ssize_t size)
+ * - >=0 | Success! The size of the decompressed block
+ * -  -1 | The block is malformed, or doesn't fit in dest
+ */
+ssize_t lz4_decompress(const char* source, size_t length, char* dest, size_t capacity)
+{
+  const unsigned char* input = (const unsigned char*) source;
+  const unsigned char* end   = input + length;
+
+  char* output     = dest;
+  char* output_end = dest + capacity;
+
+  while(input < end)
+  {
+    unsigned char token = *input++;
+
+    size_t literal_length = token >> 4;
+
+    if(literal_length == 15 && lz4_length_read(&input, end, &literal_length) == -1) return -1;
+
+    if(literal_length > (size_t) (end - input) || literal_length > (size_t) (output_end - output)) return -1;
+
+    memcpy(output, input, literal_length);
+
+    input  += literal_length;
+    output += literal_length;
+
+    // The last sequence only has literals
+    if(input == end) break;
+
+    if(end - input < 2) return -1;
+
+    size_t offset = input[0] | (input[1] << 8);
+
+    input += 2;
+
+    size_t match_length = token & 15;
+
+    if(match_length == 15 && lz4_length_read(&input, end, &match_length) == -1) return -1;
+
+    match_length += LZ4_MIN_MATCH;
+
+    if(offset == 0 || offset > (size_t) (output - dest) || match_length > (size_t) (output_end - output)) return -1;
+
+    // The match can overlap the output, so it is copied byte by byte
+    const char* match = output - offset;
+
+    for(size_t index = 0; index < match_length; index++) output[index] = match[index];
+
+    output += match_length;
+  }
+
+  return output - dest;
+}
@@ -0,0 +1,22 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+// The largest possible size of a compressed block of length bytes
+#define LZ4_BOUND(length) ((length) + (length) / 255 + 16)
+
+extern size_t  lz4_compress(const char* source, size_t length, char* dest, size_t capacity);
+
+extern ssize_t lz4_decompress(const char* source, size_t length, char* dest, size_t capacity);
+
+#endif // LZ4_H
@@ -0,0 +1,944 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#define _GNU_SOURCE
+
+#include "mux.h"
+
+// Event tokens of the socket, the channels use two tokens each,
+// offset by MUX_TOKEN_CHANNEL, one for the input and one for the output
+#define MUX_TOKEN_SOCKET  0
+#define MUX_TOKEN_CHANNEL 1
+
+/*
+ * A named fifo pair, carried on the connection
+ *
+ * The lines of the input are sent to the channel with the same name on the peer,
+ * and the lines of the channel of the peer are written to the output
+ *
+ * The peer grants credit for as many bytes as fit in its output buffer,
+ * so a frame never has to wait for a slow output, and never blocks the other channels
+ *
+ * Every channel starts on its own, as soon as the peers of its fifos show up
+ */
+struct channel
+{
+  char          name[MUX_NAME_SIZE];
+  char*         in_path;
+  char*         out_path;
+  int           in_fd;
+  int           out_fd;
+  struct reader reader;
+  struct writer writer;
+  bool          readable;
+  bool          writable;
+  bool          opening;
+  bool          closing;
+  int           peer;
+  size_t        credit;
+  size_t        owed;
+  size_t        sent;
+  size_t        received;
+};
+
+/*
+ * The multiplexer - the connection and its event loop
+ */
+struct mux
+{
+  int           epollfd;
+  int           sockfd;
+  struct reader reader;
+  struct writer writer;
+  bool          readable;
+  bool          writable;
+  bool          shutdown;
+  int           next;
+  size_t        dropped;
+  bool          debug;
+};
+
+static struct channel channels[MUX_CHANNELS];
+
+static int channel_count = 0;
+
+// The local channel of every channel id of the peer, or -1
+static int peers[MUX_CHANNELS];
+
+/*
+ * Add a channel, from a NAME:IN:OUT argument
+ *
+ * Either of the fifos can be left out, for a channel in only one direction
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Invalid argument, or too many channels
+ */
+int mux_channel_add(char* spec)
+{
+  if(channel_count >= MUX_CHANNELS) return -1;
+
+  char* in_path = strchr(spec, ':');
+
+  if(!in_path) return -1;
+
+  char* out_path = strchr(in_path + 1, ':');
+
+  if(!out_path) return -1;
+
+  size_t name_length = in_path - spec;
+
+  if(name_length == 0 || name_length >= MUX_NAME_SIZE) return -1;
+
+  if(in_path + 1 == out_path && out_path[1] == '\0') return -1;
+
+  for(int index = 0; index < channel_count; index++)
+  {
+    if(!strncmp(channels[index].name, spec, name_length) && channels[index].name[name_length] == '\0') return -1;
+  }
+
+  struct channel* channel = &channels[channel_count++];
+
+  memset(channel, 0, sizeof(struct channel));
+
+  memcpy(channel->name, spec, name_length);
+
+  // The paths are terminated in place, in the argument
+  *in_path++  = '\0';
+  *out_path++ = '\0';
+
+  channel->in_path  = (*in_path  != '\0') ? in_path  : NULL;
+  channel->out_path = (*out_path != '\0') ? out_path : NULL;
+
+  channel->in_fd  = -1;
+  channel->out_fd = -1;
+
+  return 0;
+}
+
+/*
+ * Get the number of added channels
+ */
+int mux_channel_count(void)
+{
+  return channel_count;
+}
+
+/*
+ * Add file descriptor to the event loop of the multiplexer, with a token
+ *
+ * Note: Regular files can't be added (EPERM), but they never block,
+ *       so they are always treated as ready
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * -  1 | Success, a regular file that is always ready
+ * - -1 | Failed to add file descriptor
+ */
+static int mux_fd_add(struct mux* mux, int fd, uint32_t events, uint64_t token)
+{
+  struct epoll_event event = { .events = events, .data.u64 = token };
+
+  if(epoll_ctl(mux->epollfd, EPOLL_CTL_ADD, fd, &event) == -1)
+  {
+    if(errno != EPERM) return -1;
+
+    errno = 0;
+
+    return 1;
+  }
+
+  return 0;
+}
+
+/*
+ * Free the buffers of a channel and close its fifos
+ */
+static void channel_free(struct channel* channel, bool debug)
+{
+  reader_free(&channel->reader);
+
+  writer_free(&channel->writer);
+
+  fifo_close(&channel->in_fd, debug);
+
+  fifo_close(&channel->out_fd, debug);
+}
+
+/*
+ * Open the fifos of a channel without blocking, and initialize its buffers
+ *
+ * The input waits on the event loop for its writer to write.
+ * If the output has no reader yet, it is opened later by mux_outputs_open
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to open fifos, or to initialize buffers
+ */
+static int channel_open(struct mux* mux, int index)
+{
+  struct channel* channel = &channels[index];
+
+  channel->readable = false;
+  channel->writable = true;
+  channel->opening  = false;
+  channel->closing  = false;
+  channel->peer     = -1;
+  channel->credit   = 0;
+  channel->owed     = 0;
+  channel->sent     = 0;
+  channel->received = 0;
+
+  if(channel->in_path)
+  {
+    if(fifo_open_nonblock(&channel->in_fd, channel->in_path, O_RDONLY, mux->debug) != 0) return -1;
+
+    if(reader_init(&channel->reader, channel->in_fd, buffer_read, READER_SIZE) == -1) return -1;
+
+    int status = mux_fd_add(mux, channel->in_fd, EPOLLIN | EPOLLET, MUX_TOKEN_CHANNEL + index * 2);
+
+    if(status == -1) return -1;
+
+    channel->readable = (status == 1);
+  }
+
+  if(channel->out_path)
+  {
+    if(writer_init(&channel->writer, -1, buffer_write, MUX_WINDOW) == -1) return -1;
+
+    channel->opening = true;
+  }
+
+  return 0;
+}
+
+/*
+ * Grant the peer credit for the whole output buffer of a channel,
+ * once the channel has been paired with the peer and its output is open
+ */
+static void channel_credit_grant(struct mux* mux, struct channel* channel)
+{
+  if(channel->peer == -1 || channel->out_fd == -1) return;
+
+  channel->owed += MUX_WINDOW;
+
+  if(mux->debug) info_print("Channel (%s) output is ready", channel->name);
+}
+
+/*
+ * Try to open the outputs that have no reader yet
+ *
+ * RETURN (bool opening)
+ * - true  | Some outputs still have no reader
+ * - false | All outputs are open
+ */
+static bool mux_outputs_open(struct mux* mux)
+{
+  bool opening = false;
+
+  for(int index = 0; index < channel_count; index++)
+  {
+    struct channel* channel = &channels[index];
+
+    // The peer closed the channel, before the output had a reader
+    if(channel->closing) channel->opening = false;
+
+    if(!channel->opening) continue;
+
+    int status = fifo_open_nonblock(&channel->out_fd, channel->out_path, O_WRONLY, mux->debug);
+
+    if(status == 1)
+    {
+      opening = true;
+
+      continue;
+    }
+
+    channel->opening = false;
+
+    if(status == -1 || mux_fd_add(mux, channel->out_fd, EPOLLOUT | EPOLLET, MUX_TOKEN_CHANNEL + index * 2 + 1) == -1)
+    {
+      if(mux->debug) error_print("Failed to open output of channel (%s)", channel->name);
+
+      fifo_close(&channel->out_fd, mux->debug);
+
+      errno = 0;
+
+      continue;
+    }
+
+    channel->writer.fd = channel->out_fd;
+
+    channel_credit_grant(mux, channel);
+  }
+
+  return opening;
+}
+
+/*
+ * Check if a frame with a payload of length bytes fits in the send buffer
+ */
+static bool mux_frame_fits(const struct mux* mux, size_t length)
+{
+  return mux->writer.size - mux->writer.end >= FRAME_HEADER_SIZE + MUX_TAG_SIZE + length;
+}
+
+/*
+ * Add a frame to the send buffer, tagged with a channel id and a type
+ *
+ * Note: The frame has to fit in the send buffer, so it is never sent right away
+ */
+static void mux_frame_write(struct mux* mux, int id, int type, const char* payload, size_t length)
+{
+  char tag[MUX_TAG_SIZE] = { (id >> 8) & 0xff, id & 0xff, (type >> 8) & 0xff, type & 0xff };
+
+  writer_frame_header_write(&mux->writer, MUX_TAG_SIZE + length);
+
+  writer_write(&mux->writer, tag, MUX_TAG_SIZE);
+
+  writer_write(&mux->writer, payload, length);
+}
+
+/*
+ * Close the input of a channel, and tell the peer
+ */
+static void channel_input_close(struct mux* mux, struct channel* channel)
+{
+  fifo_close(&channel->in_fd, mux->debug);
+
+  mux_frame_write(mux, channel - channels, MUX_CLOSE, NULL, 0);
+
+  if(mux->debug) info_print("Channel (%s) input closed", channel->name);
+}
+
+/*
+ * Close the output of a channel, dropping the lines that were not written
+ */
+static void channel_output_close(struct mux* mux, struct channel* channel)
+{
+  fifo_close(&channel->out_fd, mux->debug);
+
+  // The dropped lines are credited back, not to stall the peer
+  channel->owed += channel->writer.end - channel->writer.start;
+
+  channel->writer.start = 0;
+  channel->writer.end   = 0;
+
+  if(mux->debug) info_print("Channel (%s) output closed", channel->name);
+}
+
+/*
+ * Send one frame of lines from the input of a channel, its turn of the round
+ *
+ * A frame holds at most MUX_QUANTUM bytes, and no more than the credit of the channel
+ *
+ * RETURN (int status)
+ * -  1 | A frame was sent
+ * -  0 | Nothing to send
+ * - -1 | The send buffer is full
+ */
+static int channel_send(struct mux* mux, struct channel* channel)
+{
+  if(channel->in_fd == -1 || !channel->readable || channel->credit == 0) return 0;
+
+  size_t size = (channel->credit < MUX_QUANTUM) ? channel->credit : MUX_QUANTUM;
+
+  if(!mux_frame_fits(mux, size)) return -1;
+
+  const char* lines;
+
+  ssize_t length = reader_lines_read(&channel->reader, &lines, size);
+
+  if(length == -1)
+  {
+    if(errno == EAGAIN || errno == EWOULDBLOCK)
+    {
+      errno = 0;
+
+      channel->readable = false;
+
+      return 0;
+    }
+
+    if(mux->debug) error_print("Failed to read channel (%s): %s", channel->name, strerror(errno));
+
+    errno = 0;
+  }
+
+  // End of file, or an error other than no more bytes to read
+  if(length <= 0)
+  {
+    channel_input_close(mux, channel);
+
+    return 1;
+  }
+
+  mux_frame_write(mux, channel - channels, MUX_DATA, lines, length);
+
+  channel->credit -= length;
+
+  channel->sent   += length;
+
+  return 1;
+}
+
+/*
+ * Give every channel a turn to send a frame, round after round,
+ * until there is nothing more to send or the send buffer is full
+ *
+ * A busy channel sends one frame per round, like every other channel,
+ * so it can't starve them. The next round starts at the channel
+ * that was next in turn when the send buffer got full
+ *
+ * RETURN (bool full)
+ * - true  | The send buffer is full
+ * - false | Nothing more to send
+ */
+static bool mux_channels_send(struct mux* mux)
+{
+  bool progress = true;
+
+  while(progress)
+  {
+    progress = false;
+
+    for(int turn = 0; turn < channel_count; turn++)
+    {
+      int status = channel_send(mux, &channels[mux->next]);
+
+      if(status == -1) return true;
+
+      if(status == 1) progress = true;
+
+      mux->next = (mux->next + 1) % channel_count;
+    }
+  }
+
+  return false;
+}
+
+/*
+ * Send the credit of the bytes that were written to the outputs,
+ * once a quantum of bytes has been written or the output is drained
+ *
+ * RETURN (bool full)
+ * - true  | The send buffer is full
+ * - false | All credit that is due is sent
+ */
+static bool mux_credits_send(struct mux* mux)
+{
+  for(int index = 0; index < channel_count; index++)
+  {
+    struct channel* channel = &channels[index];
+
+    if(channel->peer == -1 || channel->owed == 0) continue;
+
+    if(channel->owed < MUX_QUANTUM && writer_pending(&channel->writer)) continue;
+
+    if(!mux_frame_fits(mux, FRAME_HEADER_SIZE)) return true;
+
+    char credit[FRAME_HEADER_SIZE];
+
+    frame_header_encode(credit, channel->owed);
+
+    mux_frame_write(mux, channel->peer, MUX_CREDIT, credit, FRAME_HEADER_SIZE);
+
+    channel->owed = 0;
+  }
+
+  return false;
+}
+
+/*
+ * Send credit and frames of lines, and flush them to the socket,
+ * until there is nothing more to send or the socket is full
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to write to socket
+ */
+static int mux_socket_pump(struct mux* mux)
+{
+  while(true)
+  {
+    bool full = mux_credits_send(mux);
+
+    if(mux_channels_send(mux)) full = true;
+
+    if(!mux->writable || !writer_pending(&mux->writer)) return 0;
+
+    int status = writer_flush_nonblock(&mux->writer);
+
+    if(status == -1) return -1;
+
+    if(status == 1)
+    {
+      mux->writable = false;
+
+      return 0;
+    }
+
+    if(!full) return 0;
+  }
+}
+
+/*
+ * The peer announced a channel, pair it with the local channel of the same name
+ *
+ * If the channel has an output, the peer is granted credit for its whole output buffer
+ */
+static void mux_channel_open(struct mux* mux, int id, const char* name, size_t length)
+{
+  for(int index = 0; index < channel_count; index++)
+  {
+    struct channel* channel = &channels[index];
+
+    if(strlen(channel->name) != length || strncmp(channel->name, name, length)) continue;
+
+    peers[id] = index;
+
+    channel->peer = id;
+
+    if(mux->debug) info_print("Channel (%s) opened by peer (%d)", channel->name, id);
+
+    channel_credit_grant(mux, channel);
+
+    return;
+  }
+
+  if(mux->debug) info_print("Channel (%.*s) of peer has no local channel", (int) length, name);
+}
+
+/*
+ * Queue the lines of a frame to the output of the channel
+ *
+ * The peer never sends more than its credit, so the lines always fit in the output buffer
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | The peer sent more than its credit
+ */
+static int mux_channel_data(struct mux* mux, int id, const char* lines, size_t length)
+{
+  if(peers[id] == -1)
+  {
+    mux->dropped++;
+
+    return 0;
+  }
+
+  struct channel* channel = &channels[peers[id]];
+
+  channel->received += length;
+
+  // The output is closed, so the lines are dropped and credited back
+  if(channel->out_fd == -1)
+  {
+    channel->owed += length;
+
+    return 0;
+  }
+
+  if(channel->writer.size - channel->writer.end < length)
+  {
+    if(mux->debug) error_print("Peer exceeded the credit of channel (%s)", channel->name);
+
+    return -1;
+  }
+
+  writer_write(&channel->writer, lines, length);
+
+  return 0;
+}
+
+/*
+ * Handle a single frame from the peer
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Invalid frame
+ */
+static int mux_frame_handle(struct mux* mux, const char* frame, size_t length)
+{
+  if(length < MUX_TAG_SIZE) return -1;
+
+  const unsigned char* tag = (const unsigned char*) frame;
+
+  int id   = (tag[0] << 8) | tag[1];
+
+  int type = (tag[2] << 8) | tag[3];
+
+  const char* payload = frame + MUX_TAG_SIZE;
+
+  length -= MUX_TAG_SIZE;
+
+  if(id >= MUX_CHANNELS) return -1;
+
+  if(type == MUX_OPEN)
+  {
+    mux_channel_open(mux, id, payload, length);
+
+    return 0;
+  }
+
+  if(type == MUX_DATA) return mux_channel_data(mux, id, payload, length);
+
+  if(type == MUX_CLOSE)
+  {
+    // The output is closed once the queued lines are written
+    if(peers[id] != -1) channels[peers[id]].closing = true;
+
+    return 0;
+  }
+
+  // The credit is for the channel of the receiver, which is this side
+  if(type == MUX_CREDIT && id < channel_count && length == FRAME_HEADER_SIZE)
+  {
+    channels[id].credit += frame_header_decode(payload);
+
+    return 0;
+  }
+
+  return -1;
+}
+
+/*
+ * Read all available frames from the socket, and handle them
+ *
+ * RETURN (int status)
+ * -  0 | Waiting for events
+ * -  1 | End of file
+ * - -1 | Failed to read from socket, or invalid frame
+ */
+static int mux_socket_receive(struct mux* mux)
+{
+  while(true)
+  {
+    int status = reader_frame_fill(&mux->reader);
+
+    if(status == -1)
+    {
+      if(errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+
+      errno = 0;
+
+      mux->readable = false;
+
+      return 0;
+    }
+
+    if(status == 0) return 1;
+
+    uint32_t length;
+
+    reader_frame_header_read(&mux->reader, &length);
+
+    const char* frame = NULL;
+
+    if(length > 0) reader_chunk_read(&mux->reader, &frame, length);
+
+    if(mux_frame_handle(mux, frame, length) == -1)
+    {
+      if(mux->debug) error_print("Invalid frame from peer");
+
+      return -1;
+    }
+  }
+}
+
+/*
+ * Write the queued lines of all writable outputs without waiting,
+ * and close the outputs that the peer closed, once they are drained
+ *
+ * The written bytes are owed to the peer as credit
+ */
+static void mux_outputs_flush(struct mux* mux)
+{
+  for(int index = 0; index < channel_count; index++)
+  {
+    struct channel* channel = &channels[index];
+
+    if(channel->out_fd == -1) continue;
+
+    if(channel->writable && writer_pending(&channel->writer))
+    {
+      size_t before = channel->writer.end - channel->writer.start;
+
+      int status = writer_flush_nonblock(&channel->writer);
+
+      if(status == -1)
+      {
+        if(mux->debug) error_print("Failed to write channel (%s): %s", channel->name, strerror(errno));
+
+        errno = 0;
+
+        channel_output_close(mux, channel);
+
+        continue;
+      }
+
+      if(status == 1) channel->writable = false;
+
+      channel->owed += before - (channel->writer.end - channel->writer.start);
+    }
+
+    if(channel->closing && !writer_pending(&channel->writer))
+    {
+      channel_output_close(mux, channel);
+    }
+  }
+}
+
+/*
+ * Write the queued lines of all outputs, waiting while they are full,
+ * when no more lines will come from the peer
+ */
+static void mux_outputs_drain(struct mux* mux)
+{
+  for(int index = 0; index < channel_count; index++)
+  {
+    struct channel* channel = &channels[index];
+
+    if(channel->out_fd != -1 && writer_flush(&channel->writer) == -1)
+    {
+      if(mux->debug) error_print("Failed to write channel (%s): %s", channel->name, strerror(errno));
+
+      errno = 0;
+    }
+  }
+}
+
+/*
+ * Check if all inputs have been sent and all outputs have been closed by the peer
+ */
+static bool mux_channels_done(void)
+{
+  for(int index = 0; index < channel_count; index++)
+  {
+    const struct channel* channel = &channels[index];
+
+    if(channel->in_fd != -1 || channel->out_fd != -1 || channel->opening) return false;
+  }
+
+  return true;
+}
+
+/*
+ * Mark the socket or the fifo of the event as ready
+ */
+static void mux_event_mark(struct mux* mux, struct epoll_event* event)
+{
+  if(event->data.u64 == MUX_TOKEN_SOCKET)
+  {
+    if(event->events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) mux->readable = true;
+
+    if(event->events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) mux->writable = true;
+
+    return;
+  }
+
+  int token = event->data.u64 - MUX_TOKEN_CHANNEL;
+
+  if(token % 2 == 0) channels[token / 2].readable = true;
+
+  else channels[token / 2].writable = true;
+}
+
+/*
+ * Print the number of bytes every channel sent and received
+ */
+static void mux_stats_print(const struct mux* mux)
+{
+  for(int index = 0; index < channel_count; index++)
+  {
+    const struct channel* channel = &channels[index];
+
+    info_print("Channel (%s) sent %ld bytes (%ld lines), received %ld bytes",
+      channel->name, (long) channel->sent, (long) channel->reader.lines, (long) channel->received);
+  }
+
+  if(mux->dropped > 0) info_print("Dropped %ld frames of unknown channels", (long) mux->dropped);
+}
+
+/*
+ * Free everything of the multiplexer, and close the fifos of all channels
+ */
+static void mux_free(struct mux* mux)
+{
+  for(int index = 0; index < channel_count; index++)
+  {
+    channel_free(&channels[index], mux->debug);
+  }
+
+  reader_free(&mux->reader);
+
+  writer_free(&mux->writer);
+
+  event_loop_close(&mux->epollfd, mux->debug);
+}
+
+/*
+ * Initialize the multiplexer, with the connection and the fifos of all channels,
+ * and announce the channels to the peer
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to initialize multiplexer
+ */
+static int mux_init(struct mux* mux, int sockfd, bool debug)
+{
+  memset(mux, 0, sizeof(struct mux));
+
+  mux->sockfd   = sockfd;
+  mux->readable = true;
+  mux->writable = true;
+  mux->debug    = debug;
+
+  for(int id = 0; id < MUX_CHANNELS; id++) peers[id] = -1;
+
+  if((mux->epollfd = event_loop_create(debug)) == -1) return -1;
+
+  if(reader_init(&mux->reader, sockfd, socket_read, READER_SIZE) == -1 ||
+     writer_init(&mux->writer, sockfd, socket_write, WRITER_SIZE) == -1)
+  {
+    mux_free(mux);
+
+    return -1;
+  }
+
+  event_fd_nonblock(sockfd);
+
+  if(mux_fd_add(mux, sockfd, EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP, MUX_TOKEN_SOCKET) == -1)
+  {
+    mux_free(mux);
+
+    return -1;
+  }
+
+  for(int index = 0; index < channel_count; index++)
+  {
+    if(channel_open(mux, index) == -1)
+    {
+      if(debug) error_print("Failed to open channel (%s)", channels[index].name);
+
+      mux_free(mux);
+
+      return -1;
+    }
+
+    mux_frame_write(mux, index, MUX_OPEN, channels[index].name, strlen(channels[index].name));
+  }
+
+  // The fill and flush functions fail on a leftover error
+  errno = 0;
+
+  return 0;
+}
+
+/*
+ * Run the multiplexer - carry the lines of any number of named fifo pairs
+ * over a single connection, driven by a single-threaded event loop
+ *
+ * Every frame is tagged with the channel it belongs to. The channels take turns
+ * to send a frame each, and every channel has its own credit, so neither a busy input
+ * nor a slow output of one channel holds up the other channels
+ *
+ * The multiplexer runs until the connection is closed, after all channels
+ * of both peers are closed in both directions, or until it is interrupted
+ *
+ * RETURN (int status)
+ * - 0 | Success, end of file or interrupted
+ * - 1 | Failed to initialize multiplexer
+ * - 2 | Failed to wait for events
+ * - 3 | Failed to relay over the connection
+ */
+int mux_run(int sockfd, bool debug)
+{
+  struct mux mux;
+
+  if(mux_init(&mux, sockfd, debug) == -1) return 1;
+
+  if(debug) info_print("Start of multiplexer, %d channels", channel_count);
+
+  int status = 0;
+
+  struct epoll_event events[EVENT_COUNT];
+
+  while(true)
+  {
+    // The outputs without a reader are retried, until their readers show up
+    bool opening = mux_outputs_open(&mux);
+
+    if(mux.readable)
+    {
+      int receive_status = mux_socket_receive(&mux);
+
+      if(receive_status == 1)
+      {
+        if(debug) info_print("Connection closed by peer");
+
+        mux_outputs_drain(&mux);
+
+        break;
+      }
+
+      if(receive_status == -1)
+      {
+        if(debug) error_print("Failed to receive frames: %s", strerror(errno));
+
+        status = 3;
+
+        break;
+      }
+    }
+
+    mux_outputs_flush(&mux);
+
+    if(!mux.shutdown && mux_socket_pump(&mux) == -1)
+    {
+      if(debug) error_print("Failed to send frames: %s", strerror(errno));
+
+      status = 3;
+
+      break;
+    }
+
+    // Closing the socket with unread frames would reset the connection,
+    // so only the sending side is shut down, and the peer closes the connection
+    if(!mux.shutdown && mux_channels_done() && !writer_pending(&mux.writer))
+    {
+      if(debug) info_print("All channels closed, waiting for peer");
+
+      shutdown(sockfd, SHUT_WR);
+
+      mux.shutdown = true;
+    }
+
+    int event_count = epoll_wait(mux.epollfd, events, EVENT_COUNT, opening ? FIFO_RETRY_INTERVAL : -1);
+
+    if(event_count == -1)
+    {
+      if(errno != EINTR) status = 2;
+
+      break;
+    }
+
+    for(int index = 0; index < event_count; index++)
+    {
+      mux_event_mark(&mux, &events[index]);
+    }
+  }
+
+  if(debug) info_print("End of multiplexer");
+
+  if(debug) mux_stats_print(&mux);
+
+  mux_free(&mux);
+
+  errno = 0;
+
+  return status;
+}
@@ -0,0 +1,44 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef MUX_H
+#define MUX_H
+
+#include "debug.h"
+#include "event.h"
+#include "reader.h"
+#include "writer.h"
+#include "socket.h"
+#include "frame.h"
+#include "fifo.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#define MUX_CHANNELS  64
+#define MUX_NAME_SIZE 64
+#define MUX_QUANTUM   16384       // Bytes a channel may send per turn
+#define MUX_WINDOW    WRITER_SIZE // Bytes a channel may have in flight, the size of its output buffer
+
+// Every frame is tagged with a channel id and a type, after the frame header
+#define MUX_TAG_SIZE 4
+
+#define MUX_OPEN   0 // The name of a channel of the sender
+#define MUX_DATA   1 // Lines of a channel of the sender
+#define MUX_CLOSE  2 // End of the input of a channel of the sender
+#define MUX_CREDIT 3 // Bytes that a channel of the receiver may send
+
+extern int mux_channel_add(char* spec);
+
+extern int mux_channel_count(void);
+
+extern int mux_run(int sockfd, bool debug);
+
+#endif // MUX_H
@@ -0,0 +1,411 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#include "pool.h"
+
+/*
+ * Header in front of every block, aligned to a cache line
+ *
+ * Blocks that the pool couldn't provide are allocated with malloc,
+ * and are marked with a class of -1
+ */
+struct pool_block
+{
+  struct pool_block* next;
+  int                class;
+} __attribute__((aligned(64)));
+
+/*
+ * Size class, with the shared free list of its blocks
+ */
+struct pool_class
+{
+  size_t             size;
+  size_t             count;
+  struct pool_block* blocks;
+  size_t             used;
+  size_t             high;
+  size_t             failures;
+};
+
+/*
+ * The message pool of the process, preallocated in one mapping
+ */
+static struct
+{
+  pthread_mutex_t   lock;
+  pthread_key_t     key;
+  bool              created;
+  char*             memory;
+  size_t            length;
+  struct pool_class classes[POOL_CLASSES];
+} pool = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/*
+ * Free lists of a thread, so that most allocations don't take the lock
+ */
+struct pool_cache
+{
+  struct pool_block* blocks[POOL_CLASSES];
+  int                counts[POOL_CLASSES];
+};
+
+static __thread struct pool_cache cache;
+
+/*
+ * Give the blocks in the free lists of a thread back to the pool
+ */
+static void pool_cache_flush(void* arg)
+{
+  pthread_mutex_lock(&pool.lock);
+
+  for(int class = 0; class < POOL_CLASSES; class++)
+  {
+    while(cache.blocks[class])
+    {
+      struct pool_block* block = cache.blocks[class];
+
+      cache.blocks[class] = block->next;
+
+      block->next = pool.classes[class].blocks;
+
+      pool.classes[class].blocks = block;
+    }
+
+    cache.counts[class] = 0;
+  }
+
+  pthread_mutex_unlock(&pool.lock);
+}
+
+/*
+ * Map the memory of the pool, on huge pages if requested and available
+ *
+ * RETURN (char* memory)
+ * - !NULL | Success
+ * -  NULL | Failed to map memory
+ */
+static char* pool_memory_map(size_t length, bool hugepages, bool debug)
+{
+  if(hugepages)
+  {
+    size_t huge_length = (length + (2 << 20) - 1) & ~((size_t) (2 << 20) - 1);
+
+    void* memory = mmap(NULL, huge_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+
+    if(memory != MAP_FAILED)
+    {
+      if(debug) info_print("Mapped message pool on huge pages (%ld bytes)", (long) huge_length);
+
+      pool.length = huge_length;
+
+      return memory;
+    }
+
+    if(debug) error_print("Failed to map huge pages: %s", strerror(errno));
+
+    errno = 0;
+  }
+
+  void* memory = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if(memory == MAP_FAILED) return NULL;
+
+  // Transparent huge pages are the fallback for explicit huge pages
+  if(hugepages) madvise(memory, length, MADV_HUGEPAGE);
+
+  // Touch every page now, instead of on the first use of a block
+  memset(memory, 0, length);
+
+  if(debug) info_print("Mapped message pool (%ld bytes)", (long) length);
+
+  pool.length = length;
+
+  return memory;
+}
+
+/*
+ * Preallocate the blocks of every size class
+ *
+ * PARAMS
+ * - const size_t counts[] | The number of blocks in every size class
+ * - bool hugepages        | Put the blocks on huge pages
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to allocate the pool
+ */
+int pool_create(const size_t counts[POOL_CLASSES], bool hugepages, bool debug)
+{
+  const size_t sizes[POOL_CLASSES] = POOL_SIZES;
+
+  size_t length = 0;
+
+  for(int class = 0; class < POOL_CLASSES; class++)
+  {
+    length += counts[class] * (sizeof(struct pool_block) + sizes[class]);
+  }
+
+  pool.memory = pool_memory_map(length, hugepages, debug);
+
+  if(!pool.memory)
+  {
+    if(debug) error_print("Failed to allocate message pool: %s", strerror(errno));
+
+    return -1;
+  }
+
+  char* pointer = pool.memory;
+
+  for(int class = 0; class < POOL_CLASSES; class++)
+  {
+    pool.classes[class] = (struct pool_class) { .size = sizes[class], .count = counts[class] };
+
+    for(size_t index = 0; index < counts[class]; index++)
+    {
+      struct pool_block* block = (struct pool_block*) pointer;
+
+      block->class = class;
+      block->next  = pool.classes[class].blocks;
+
+      pool.classes[class].blocks = block;
+
+      pointer += sizeof(struct pool_block) + sizes[class];
+    }
+  }
+
+  pthread_key_create(&pool.key, pool_cache_flush);
+
+  pool.created = true;
+
+  return 0;
+}
+
+/*
+ * Unmap the memory of the pool
+ *
+ * Note: Every block has to be released first
+ */
+void pool_free(bool debug)
+{
+  if(!pool.created) return;
+
+  if(debug) pool_stats_print();
+
+  pool.created = false;
+
+  memset(&cache, 0, sizeof(cache));
+
+  munmap(pool.memory, pool.length);
+
+  pool.memory = NULL;
+}
+
+/*
+ * Check if the blocks of the class are cached by the threads
+ *
+ * A class with few blocks is not cached, so that one thread can't hold
+ * all of its blocks while another thread needs one
+ */
+static bool pool_class_cached(int class)
+{
+  return pool.classes[class].count >= POOL_CACHE * 4;
+}
+
+/*
+ * Move a block from the shared free list of the class to another list
+ */
+static struct pool_block* pool_shared_take(int class)
+{
+  struct pool_block* block = pool.classes[class].blocks;
+
+  if(block) pool.classes[class].blocks = block->next;
+
+  return block;
+}
+
+/*
+ * Take a block of the class, from the free list of the thread,
+ * refilling it from the shared free list when it is empty
+ */
+static struct pool_block* pool_block_take(int class)
+{
+  if(!pool_class_cached(class))
+  {
+    pthread_mutex_lock(&pool.lock);
+
+    struct pool_block* block = pool_shared_take(class);
+
+    pthread_mutex_unlock(&pool.lock);
+
+    return block;
+  }
+
+  if(!cache.blocks[class])
+  {
+    // The free lists of the thread are given back when the thread ends
+    pthread_setspecific(pool.key, &cache);
+
+    pthread_mutex_lock(&pool.lock);
+
+    struct pool_block* block;
+
+    for(int index = 0; index < POOL_CACHE / 2 && (block = pool_shared_take(class)); index++)
+    {
+      block->next = cache.blocks[class];
+
+      cache.blocks[class] = block;
+
+      cache.counts[class]++;
+    }
+
+    pthread_mutex_unlock(&pool.lock);
+  }
+
+  struct pool_block* block = cache.blocks[class];
+
+  if(!block) return NULL;
+
+  cache.blocks[class] = block->next;
+
+  cache.counts[class]--;
+
+  return block;
+}
+
+/*
+ * Allocate a block of at least size bytes from the smallest size class that fits
+ *
+ * If the size class is used up, or the size is larger than every class,
+ * the block is allocated with malloc and counted as a failure
+ *
+ * RETURN (void* pointer)
+ * - !NULL | Success
+ * -  NULL | Failed to allocate block
+ */
+void* pool_alloc(size_t size)
+{
+  int class = 0;
+
+  while(class < POOL_CLASSES && (!pool.created || pool.classes[class].size < size)) class++;
+
+  struct pool_block* block = (class < POOL_CLASSES) ? pool_block_take(class) : NULL;
+
+  if(block)
+  {
+    size_t used = __atomic_add_fetch(&pool.classes[class].used, 1, __ATOMIC_RELAXED);
+
+    size_t high = __atomic_load_n(&pool.classes[class].high, __ATOMIC_RELAXED);
+
+    while(used > high && !__atomic_compare_exchange_n(&pool.classes[class].high, &high, used, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    return block + 1;
+  }
+
+  if(class < POOL_CLASSES) __atomic_add_fetch(&pool.classes[class].failures, 1, __ATOMIC_RELAXED);
+
+  else if(pool.created) __atomic_add_fetch(&pool.classes[POOL_CLASSES - 1].failures, 1, __ATOMIC_RELAXED);
+
+  block = malloc(sizeof(struct pool_block) + size);
+
+  if(!block) return NULL;
+
+  block->class = -1;
+
+  return block + 1;
+}
+
+/*
+ * Give a block back to the free list of the thread,
+ * moving half of it to the shared free list when it is full
+ */
+void pool_release(void* pointer)
+{
+  if(!pointer) return;
+
+  struct pool_block* block = (struct pool_block*) pointer - 1;
+
+  int class = block->class;
+
+  if(class == -1)
+  {
+    free(block);
+
+    return;
+  }
+
+  __atomic_sub_fetch(&pool.classes[class].used, 1, __ATOMIC_RELAXED);
+
+  if(!pool_class_cached(class))
+  {
+    pthread_mutex_lock(&pool.lock);
+
+    block->next = pool.classes[class].blocks;
+
+    pool.classes[class].blocks = block;
+
+    pthread_mutex_unlock(&pool.lock);
+
+    return;
+  }
+
+  block->next = cache.blocks[class];
+
+  cache.blocks[class] = block;
+
+  if(++cache.counts[class] <= POOL_CACHE) return;
+
+  pthread_mutex_lock(&pool.lock);
+
+  while(cache.counts[class] > POOL_CACHE / 2)
+  {
+    block = cache.blocks[class];
+
+    cache.blocks[class] = block->next;
+
+    block->next = pool.classes[class].blocks;
+
+    pool.classes[class].blocks = block;
+
+    cache.counts[class]--;
+  }
+
+  pthread_mutex_unlock(&pool.lock);
+}
+
+/*
+ * Get the usage of every size class
+ */
+void pool_stats_get(struct pool_stats stats[POOL_CLASSES])
+{
+  for(int class = 0; class < POOL_CLASSES; class++)
+  {
+    stats[class] = (struct pool_stats)
+    {
+      .size     = pool.classes[class].size,
+      .count    = pool.classes[class].count,
+      .used     = __atomic_load_n(&pool.classes[class].used,     __ATOMIC_RELAXED),
+      .high     = __atomic_load_n(&pool.classes[class].high,     __ATOMIC_RELAXED),
+      .failures = __atomic_load_n(&pool.classes[class].failures, __ATOMIC_RELAXED)
+    };
+  }
+}
+
+/*
+ * Print the usage of every size class
+ */
+void pool_stats_print(void)
+{
+  struct pool_stats stats[POOL_CLASSES];
+
+  pool_stats_get(stats);
+
+  for(int class = 0; class < POOL_CLASSES; class++)
+  {
+    info_print("Pool class %ld: %ld of %ld blocks used (high-water %ld), %ld failures",
+      (long) stats[class].size, (long) stats[class].used, (long) stats[class].count, (long) stats[class].high, (long) stats[class].failures);
+  }
+}
@@ -0,0 +1,53 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include "debug.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#define POOL_CLASSES 6
+#define POOL_CACHE   8 // Blocks per size class in the free list of a thread
+
+// The sizes of the blocks in every size class
+#define POOL_SIZES  { 1024, 4096, 16384, 65536, 262144, 2097152 }
+
+// The default number of blocks in every size class
+#define POOL_COUNTS { 64,   16,   8,     8,     4,      0 }
+
+/*
+ * Usage of a size class, for statistics
+ */
+struct pool_stats
+{
+  size_t size;
+  size_t count;
+  size_t used;
+  size_t high;
+  size_t failures;
+};
+
+extern int   pool_create(const size_t counts[POOL_CLASSES], bool hugepages, bool debug);
+
+extern void  pool_free(bool debug);
+
+extern void* pool_alloc(size_t size);
+
+extern void  pool_release(void* pointer);
+
+extern void  pool_stats_get(struct pool_stats stats[POOL_CLASSES]);
+
+extern void  pool_stats_print(void);
+
+#endif // POOL_H
@@ -1,20 +1,41 @@
 /*
  * Written by Hampus Fridholm
  *
- * Last updated: 2024-09-08
+ * Last updated: 2026-10-15
  */
 
+#define _GNU_SOURCE
+
 #define DEFAULT_ADDRESS "127.0.0.1"
 #define DEFAULT_PORT    5555
 
+#define RECONNECT_DELAY_MIN 100  // Milliseconds
+#define RECONNECT_DELAY_MAX 5000 // Milliseconds
+
 #include <stdlib.h>
 #include <stdbool.h>
 #include <argp.h>
+#include <time.h>
 
 #include "debug.h"
 #include "fifo.h"
 #include "socket.h"
 #include "thread.h"
+#include "reader.h"
+#include "writer.h"
+#include "splice.h"
+#include "event.h"
+#include "uring.h"
+#include "hub.h"
+#include "shm.h"
+#include "replay.h"
+#include "queue.h"
+#include "pool.h"
+#include "compress.h"
+#include "counter.h"
+#include "capture.h"
+#include "mux.h"
+#include "batch.h"
 
 pthread_t stdin_thread;
 bool      stdin_running = false;
@@ -25,8 +46,6 @@ bool      stdout_running = false;
 int sockfd = -1;
 int servfd = -1;
 
-bool fifo_reverse = false;
-
 int stdin_fifo  = -1;
 int stdout_fifo = -1;
 
@@ -40,6 +59,25 @@ static struct argp_option options[] =
   { "stdout",  'o', "FIFO",    0, "Stdout fifo" },
   { "address", 'a', "ADDRESS", 0, "Network address" },
   { "port",    'p', "PORT",    0, "Network port" },
+  { "unix",    'U', "PATH",    0, "Unix socket path, or @name in the abstract namespace" },
+  { "shm",     's', 0,         0, "Replace the unix socket with shared memory rings" },
+  { "reconnect", 'R', 0,       0, "Reconnect when the connection is lost, replaying unacknowledged lines" },
+  { "stages",  'S', 0,         0, "Read and write on separate threads, joined by a queue" },
+  { "hugepages", 'H', 0,       0, "Put the message pool on huge pages" },
+  { "pipe-size", 'W', "BYTES", 0, "Grow the buffers of the fifos as they fill up, up to BYTES" },
+  { "batch",   'B', "BYTES:LINES:USEC", 0, "Send lines to the socket in batches of up to BYTES or LINES, waiting at most USEC for more" },
+  { "latency", 'L', 0,         0, "Record latency histograms of the read, frame and write hops" },
+  { "capture", 'c', "FILE",    0, "Capture every forwarded line, in both directions, to a file" },
+  { "play",    'P', "FILE",    0, "Play back the stdin lines of a capture file, instead of reading stdin" },
+  { "fast",    'F', 0,         0, "Play back as fast as possible, instead of at the original pacing" },
+  { "compress", 'z', 0,        0, "Compress batches of lines on the socket, if the peer agrees" },
+  { "channel", 'C', "NAME:IN:OUT", 0, "Carry a named fifo pair on a channel of the connection, can be repeated" },
+  { "raw",     'r', 0,         0, "Relay bytes without copying (zero-copy)" },
+  { "epoll",   'e', 0,         0, "Run on a single-threaded epoll event loop" },
+  { "uring",   'u', 0,         0, "Relay bytes with io_uring" },
+  { "hub",     'h', 0,         0, "Broadcast between any number of clients, as server" },
+  { "topics",  't', 0,         0, "Route hub lines by topic subscriptions" },
+  { "binary",  'b', 0,         0, "Relay length-prefixed binary frames instead of lines" },
   { "debug",   'd', 0,         0, "Print debug messages" },
   { 0 }
 };
@@ -50,6 +88,28 @@ struct args
   char*  stdout_path;
   char*  address;
   int    port;
+  char*  unix_path;
+  bool   shm;
+  bool   reconnect;
+  bool   stages;
+  bool   hugepages;
+  int    pipe_size;
+  bool   batch;
+  size_t batch_bytes;
+  size_t batch_lines;
+  long   batch_window;
+  bool   compress;
+  bool   mux;
+  bool   latency;
+  char*  capture_path;
+  char*  play_path;
+  bool   play_fast;
+  bool   raw;
+  bool   epoll;
+  bool   uring;
+  bool   hub;
+  bool   topics;
+  bool   binary;
   bool   debug;
 };
 
@@ -59,6 +119,28 @@ struct args args =
   .stdout_path = NULL,
   .address     = NULL,
   .port        = -1,
+  .unix_path   = NULL,
+  .shm         = false,
+  .reconnect   = false,
+  .stages      = false,
+  .hugepages   = false,
+  .pipe_size   = 0,
+  .batch       = false,
+  .batch_bytes = 0,
+  .batch_lines = 0,
+  .batch_window = 0,
+  .compress    = false,
+  .mux         = false,
+  .latency     = false,
+  .capture_path = NULL,
+  .play_path   = NULL,
+  .play_fast   = false,
+  .raw         = false,
+  .epoll       = false,
+  .uring       = false,
+  .hub         = false,
+  .topics      = false,
+  .binary      = false,
   .debug       = false
 };
 
@@ -72,10 +154,6 @@ static error_t opt_parse(int key, char* arg, struct argp_state* state)
   switch(key)
   {
     case 'i':
-      // If the output fifo has already been inputted,
-      // open the output fifo before the input fifo
-      if(args->stdout_path) fifo_reverse = true;
-
       args->stdin_path = arg;
       break;
 
@@ -93,6 +171,93 @@ static error_t opt_parse(int key, char* arg, struct argp_state* state)
       if(port != 0) args->port = port;
       break;
 
+    case 'U':
+      args->unix_path = arg;
+      break;
+
+    case 's':
+      args->shm = true;
+      break;
+
+    case 'R':
+      args->reconnect = true;
+      break;
+
+    case 'S':
+      args->stages = true;
+      break;
+
+    case 'H':
+      args->hugepages = true;
+      break;
+
+    case 'W':
+      args->pipe_size = atoi(arg);
+      break;
+
+    case 'B':
+      if(batch_spec_parse(arg, &args->batch_bytes, &args->batch_lines, &args->batch_window) == -1)
+      {
+        argp_error(state, "Invalid batching policy (%s), expected BYTES:LINES:USEC", arg);
+      }
+
+      args->batch = true;
+      break;
+
+    case 'z':
+      args->compress = true;
+      break;
+
+    case 'C':
+      if(mux_channel_add(arg) == -1)
+      {
+        argp_error(state, "Invalid or duplicate channel (%s), expected NAME:IN:OUT", arg);
+      }
+
+      args->mux = true;
+      break;
+
+    case 'L':
+      args->latency = true;
+      break;
+
+    case 'c':
+      args->capture_path = arg;
+      break;
+
+    case 'P':
+      args->play_path = arg;
+      break;
+
+    case 'F':
+      args->play_fast = true;
+      break;
+
+    case 'r':
+      args->raw = true;
+      break;
+
+    case 'e':
+      args->epoll = true;
+      break;
+
+    case 'u':
+      args->uring = true;
+      break;
+
+    case 'h':
+      args->hub = true;
+      break;
+
+    case 't':
+      args->hub    = true;
+      args->topics = true;
+      break;
+
+    case 'b':
+      args->binary = true;
+      break;
+
     case 'd':
       args->debug = true;
       break;
@@ -101,6 +266,90 @@ static error_t opt_parse(int key, char* arg, struct argp_state* state)
       break;
 
     case ARGP_KEY_END:
+      // The shared memory rings are passed over a unix socket,
+      // and are only used by the stdin and stdout threads
+      if(args->shm && !args->unix_path)
+      {
+        argp_error(state, "--shm requires --unix");
+      }
+
+      if(args->shm && (args->epoll || args->hub))
+      {
+        argp_error(state, "--shm can't be combined with --epoll or --hub");
+      }
+
+      // The frames are relayed by the stdin and stdout threads, the epoll and hub engines are line based
+      if(args->binary && (args->epoll || args->hub))
+      {
+        argp_error(state, "--binary can't be combined with --epoll or --hub");
+      }
+
+      // The replay buffer is line based, and used by the stdin and stdout threads
+      if(args->reconnect && (args->shm || args->binary || args->epoll || args->hub))
+      {
+        argp_error(state, "--reconnect can't be combined with --shm, --binary, --epoll or --hub");
+      }
+
+      // The queue carries lines between the stages of the stdin and stdout threads
+      if(args->stages && (args->reconnect || args->binary || args->epoll || args->hub))
+      {
+        argp_error(state, "--stages can't be combined with --reconnect, --binary, --epoll or --hub");
+      }
+
+      // The compressed frames are read and written by the stdin and stdout threads
+      if(args->compress && (args->shm || args->reconnect || args->epoll || args->hub))
+      {
+        argp_error(state, "--compress can't be combined with --shm, --reconnect, --epoll or --hub");
+      }
+
+      // Lines are captured and played back by the routines, not by the hub
+      if(args->capture_path && (args->binary || args->hub))
+      {
+        argp_error(state, "--capture can't be combined with --binary or --hub");
+      }
+
+      // The played back lines are not on a file descriptor that epoll can wait for
+      if(args->play_path && (args->binary || args->epoll || args->hub))
+      {
+        argp_error(state, "--play can't be combined with --binary, --epoll or --hub");
+      }
+
+      // A pipe can't be smaller than a page
+      if(args->pipe_size != 0 && args->pipe_size < FIFO_PIPE_MIN)
+      {
+        argp_error(state, "--pipe-size must be at least %d bytes", FIFO_PIPE_MIN);
+      }
+
+      // The batches are collected by the line relay of the stdin thread,
+      // which waits for more lines on the file descriptor of its reader
+      if(args->batch && (args->stages || args->binary || args->raw || args->uring || args->epoll || args->hub ||
+         args->mux || args->play_path))
+      {
+        argp_error(state, "--batch can't be combined with --stages, --binary, --raw, --uring, --epoll, --hub, --channel or --play");
+      }
+
+      if(args->batch && !args->address && args->port == -1 && !args->unix_path)
+      {
+        argp_error(state, "--batch requires --address, --port or --unix");
+      }
+
+      if(args->play_fast && !args->play_path)
+      {
+        argp_error(state, "--fast requires --play");
+      }
+
+      // The channels replace the stdin and stdout fifos, and are driven by an event loop of their own
+      if(args->mux && (args->stdin_path || args->stdout_path || args->shm || args->reconnect || args->stages ||
+         args->compress || args->epoll || args->hub || args->binary || args->raw || args->uring ||
+         args->capture_path || args->play_path))
+      {
+        argp_error(state, "--channel can't be combined with --stdin, --stdout, --shm, --reconnect, --stages, --compress, --epoll, --hub, --binary, --raw, --uring, --capture or --play");
+      }
+
+      if(args->mux && !args->address && args->port == -1 && !args->unix_path)
+      {
+        argp_error(state, "--channel requires --address, --port or --unix");
+      }
       break;
 
     default:
@@ -111,77 +360,201 @@ static error_t opt_parse(int key, char* arg, struct argp_state* state)
 }
 
 /*
- * The stdin thread reads from either [stdin] or [stdin fifo]
+ * Open a fifo of a routine, waiting for its peer,
+ * without holding up the routine of the other direction
+ *
+ * Note: If the fifo is already open, nothing is done
+ *
+ * RETURN (same as fifos_open)
+ */
+static int routine_fifo_open(int* fifo, const char* path, int flags)
+{
+  struct fifo_open open = { .fifo = fifo, .path = path, .flags = flags };
+
+  return fifos_open(&open, 1, args.debug);
+}
+
+/*
+ * Open both fifos at once, for the routines that run on a single thread
+ *
+ * RETURN (same as fifos_open)
+ */
+static int args_fifos_open(void)
+{
+  struct fifo_open opens[2] =
+  {
+    { .fifo = &stdin_fifo,  .path = args.stdin_path,  .flags = O_RDONLY },
+    { .fifo = &stdout_fifo, .path = args.stdout_path, .flags = O_WRONLY }
+  };
+
+  return fifos_open(opens, 2, args.debug);
+}
+
+/*
+ * Read from [socket], either directly, through the shared memory rings
+ * or as compressed frames
+ *
+ * RETURN (same as reader_init)
+ */
+static int socket_reader_init(struct reader* reader)
+{
+  if(args.shm) return reader_init(reader, sockfd, shm_read, READER_SIZE);
+
+  if(args.compress) return reader_init(reader, sockfd, compress_read, READER_SIZE);
+
+  return reader_init(reader, sockfd, socket_read, READER_SIZE);
+}
+
+/*
+ * Write to [socket], either directly, through the shared memory rings,
+ * through the replay buffer or as compressed frames
+ *
+ * RETURN (same as writer_init)
  */
-static ssize_t stdin_thread_read(char* buffer, size_t size)
+static int socket_writer_init(struct writer* writer)
 {
+  if(args.shm) return writer_init(writer, sockfd, shm_write, WRITER_SIZE);
+
+  if(args.reconnect) return writer_init(writer, sockfd, replay_write, WRITER_SIZE);
+
+  if(args.compress) return writer_init(writer, sockfd, compress_write, WRITER_SIZE);
+
+  return writer_init(writer, sockfd, socket_write, WRITER_SIZE);
+}
+
+/*
+ * The stdin thread reads from either [stdin] or [stdin fifo],
+ * or from a played back capture file
+ *
+ * RETURN (same as reader_init)
+ */
+static int stdin_thread_reader_init(struct reader* reader)
+{
+  // 0. If a capture file is played back, read from it instead
+  if(args.play_path)
+  {
+    return reader_init(reader, -1, capture_play_read, READER_SIZE);
+  }
+
   // 1. If both [stdin fifo] AND [socket] are connected, read from [stdin fifo]
-  if(stdin_fifo != -1 && sockfd != -1)
+  if(args.stdin_path && sockfd != -1)
   {
-    return buffer_read(stdin_fifo, buffer, size);
+    if(routine_fifo_open(&stdin_fifo, args.stdin_path, O_RDONLY) == -1) return -1;
+
+    return reader_init(reader, stdin_fifo, buffer_read, READER_SIZE);
   }
   // 2. If not both [stdin fifo] AND [socket] are connected, read from [stdin]
   else
   {
-    return buffer_read(0, buffer, size);
+    return reader_init(reader, 0, buffer_read, READER_SIZE);
   }
 }
 
 /*
  * The stdin thread writes to either [stdout fifo], [socket] or [stdout]
+ *
+ * RETURN (same as writer_init)
  */
-static ssize_t stdin_thread_write(const char* buffer, size_t size)
+static int stdin_thread_writer_init(struct writer* writer)
 {
   // 1. If both [stdin fifo] and [socket] are connected, write to [socket]
-  if(stdin_fifo != -1 && sockfd != -1)
+  if(args.stdin_path && sockfd != -1)
   {
-    if(args.debug) debug_print(stdout, "FIFO => SOCKET", "%s\033[F", buffer);
-
-    return socket_write(sockfd, buffer, size);
+    return socket_writer_init(writer);
   }
   // 2. If both [stdout fifo] and [socket], but not [stdin fifo], are connected, write to [socket]
-  else if(stdout_fifo != -1 && sockfd != -1)
+  else if(args.stdout_path && sockfd != -1)
   {
-    return socket_write(sockfd, buffer, size);
+    return socket_writer_init(writer);
   }
   // 3. If [stdout fifo], but not [socket], is connected, write to [stdout fifo]
-  else if(stdout_fifo != -1)
+  else if(args.stdout_path)
   {
-    return buffer_write(stdout_fifo, buffer, size);
+    if(routine_fifo_open(&stdout_fifo, args.stdout_path, O_WRONLY) == -1) return -1;
+
+    return writer_init(writer, stdout_fifo, buffer_write, WRITER_SIZE);
   }
   // 4. If [socket], but not [stdout fifo], is connected, write to [socket]
   else if(sockfd != -1)
   {
-    return socket_write(sockfd, buffer, size);
+    return socket_writer_init(writer);
   }
   // 5. If neither [stdout fifo] nor [socket] are connected, write to [stdout]
   else
   {
-    return buffer_write(1, buffer, size);
+    return writer_init(writer, 1, buffer_write, WRITER_SIZE);
   }
-} 
+}
+
+/*
+ * Print and capture the lines of a chunk one at a time, so that every line
+ * gets a message and a capture record of its own
+ *
+ * A line that is longer than the receive buffer comes in several chunks,
+ * and its parts get a message and a record each
+ *
+ * PARAMS
+ * - int direction     | The direction of the capture records
+ * - const char* title | The title of the debug messages, or NULL to not print them
+ */
+static void routine_lines_trace(int direction, const char* title, const char* lines, size_t size)
+{
+  const char* end = lines + size;
+
+  for(const char* line = lines; line < end; )
+  {
+    const char* newline = memchr(line, '\n', end - line);
+
+    size_t length = newline ? (size_t) (newline - line) + 1 : (size_t) (end - line);
+
+    if(title) debug_print(stdout, title, "%.*s\033[F", (int) length, line);
+
+    if(args.capture_path) capture_record(direction, line, length);
+
+    line += length;
+  }
+}
+
+/*
+ * Add a chunk of lines to the batch of lines written by the stdin thread
+ */
+static ssize_t stdin_thread_write(struct writer* writer, const char* buffer, size_t size)
+{
+  bool debug = args.debug && args.stdin_path && sockfd != -1;
+
+  if(debug || args.capture_path)
+  {
+    routine_lines_trace(CAPTURE_STDIN, debug ? "FIFO => SOCKET" : NULL, buffer, size);
+  }
+
+  return writer_lines_write(writer, buffer, size);
+}
 
 /*
  * The stdout thread reads from either [stdin fifo] or [socket]
  *
  * If neither [stdin fifo] nor [socket] are connected, nothing is done
+ *
+ * RETURN (same as reader_init)
  */
-static ssize_t stdout_thread_read(char* buffer, size_t size)
+static int stdout_thread_reader_init(struct reader* reader)
 {
   // 1. If both [stdin fifo] and [socket] are connected, read from [socket]
-  if(stdin_fifo != -1 && sockfd != -1)
+  if(args.stdin_path && sockfd != -1)
   {
-    return socket_read(sockfd, buffer, size);
+    return socket_reader_init(reader);
   }
   // 2. If [socket], but not [stdin fifo], is connected, read from [socket]
   else if(sockfd != -1)
   {
-    return socket_read(sockfd, buffer, size);
+    return socket_reader_init(reader);
   }
   // 3. If [stdin fifo], but not [socket], is connected, read from [stdin fifo]
-  else if(stdin_fifo != -1)
+  else if(args.stdin_path)
   {
-    return buffer_read(stdin_fifo, buffer, size);
+    if(routine_fifo_open(&stdin_fifo, args.stdin_path, O_RDONLY) == -1) return -1;
+
+    return reader_init(reader, stdin_fifo, buffer_read, READER_SIZE);
   }
   // 4. If neither [stdin fifo] nor [socket] are connected, stdout thread should not be running
   else return -1;
@@ -189,22 +562,387 @@ static ssize_t stdout_thread_read(char* buffer, size_t size)
 
 /*
  * The stdout thread writes to either [stdout fifo] or [stdout]
+ *
+ * RETURN (same as writer_init)
  */
-static ssize_t stdout_thread_write(const char* buffer, size_t size)
+static int stdout_thread_writer_init(struct writer* writer)
 {
   // 1. If both [stdout fifo] and [socket] are connected, write to [stdout fifo]
-  if(stdout_fifo != -1 && sockfd != -1)
+  if(args.stdout_path && sockfd != -1)
   {
-    if(args.debug) debug_print(stdout, "SOCKET => FIFO", "%s\033[F", buffer);
+    if(routine_fifo_open(&stdout_fifo, args.stdout_path, O_WRONLY) == -1) return -1;
 
-    return buffer_write(stdout_fifo, buffer, size);
+    return writer_init(writer, stdout_fifo, buffer_write, WRITER_SIZE);
   }
   // 2. Else, write to [stdout]
   else
   {
-    return buffer_write(1, buffer, size);
+    return writer_init(writer, 1, buffer_write, WRITER_SIZE);
+  }
+}
+
+/*
+ * Add a chunk of lines to the batch of lines written by the stdout thread
+ */
+static ssize_t stdout_thread_write(struct writer* writer, const char* buffer, size_t size)
+{
+  bool debug = args.debug && args.stdout_path && sockfd != -1;
+
+  if(debug || args.capture_path)
+  {
+    routine_lines_trace(CAPTURE_STDOUT, debug ? "SOCKET => FIFO" : NULL, buffer, size);
+  }
+
+  return writer_lines_write(writer, buffer, size);
+}
+
+/*
+ * Print the number of syscalls per line, read and written by a routine
+ */
+static void routine_stats_print(const char* name, const struct reader* reader, const struct writer* writer)
+{
+  info_print("%s read %ld lines with %ld syscalls (%f syscalls per line)", name,
+    (long) reader->lines, (long) reader->syscalls, (double) reader->syscalls / (reader->lines ? reader->lines : 1));
+
+  info_print("%s wrote %ld lines with %ld syscalls (%f lines per syscall)", name,
+    (long) writer->lines, (long) writer->syscalls, (double) writer->lines / (writer->syscalls ? writer->syscalls : 1));
+}
+
+/*
+ * Name an endpoint of a routine, for the counters
+ */
+static const char* endpoint_name(int fd)
+{
+  if(fd == -1)          return args.play_path ? "capture" : "none";
+
+  if(fd == sockfd)      return "socket";
+
+  if(fd == stdin_fifo)  return "stdin fifo";
+
+  if(fd == stdout_fifo) return "stdout fifo";
+
+  return (fd == 0) ? "stdin" : "stdout";
+}
+
+/*
+ * Count the activity of a routine in the counters of its direction, like stdin => socket,
+ * and time its hops in the histograms of the direction, if requested
+ *
+ * RETURN (struct direction* direction)
+ * - !NULL | Success!
+ * -  NULL | There is no room for more directions, the routine isn't counted
+ */
+static struct direction* routine_counters_attach(struct reader* reader, struct writer* writer)
+{
+  char name[COUNTER_NAME_SIZE];
+
+  snprintf(name, sizeof(name), "%s => %s", endpoint_name(reader->fd), endpoint_name(writer->fd));
+
+  struct direction* direction = direction_create(name);
+
+  if(!direction) return NULL;
+
+  reader->counters = &direction->read;
+
+  writer->counters = &direction->write;
+
+  if(args.latency)
+  {
+    direction->timed = true;
+
+    reader->histogram = &direction->hops[HOP_READ];
+
+    writer->histogram = &direction->hops[HOP_WRITE];
+  }
+
+  return direction;
+}
+
+/*
+ * Get the time that a routine has spent outside of read and write,
+ * which the reader and writer record by themselves
+ */
+static long routine_frame_mark(const struct reader* reader, const struct writer* writer)
+{
+  return histogram_time() - reader->blocked - writer->blocked;
+}
+
+/*
+ * Record the time that a chunk of lines spent in copying and framing,
+ * since the previous mark, if the direction is timed
+ */
+static void routine_frame_record(struct direction* direction, const struct reader* reader, const struct writer* writer, long* mark)
+{
+  if(!direction || !direction->timed) return;
+
+  long now = routine_frame_mark(reader, writer);
+
+  histogram_record(&direction->hops[HOP_FRAME], now - *mark);
+
+  *mark = now;
+}
+
+/*
+ * Relay bytes from input to output without framing them into lines,
+ * either with splice (raw mode) or with io_uring (uring mode)
+ *
+ * RETURN (int status)
+ * - 0 | Success, end of file
+ * - 1 | No fast relay is enabled or possible, fall back to buffered relay
+ * - 2 | Failed to relay
+ */
+static int fast_relay(int in_fd, int out_fd)
+{
+  // The socket only carries the shared memory rings,
+  // or has to go through the replay buffer or the compressor
+  if((args.shm || args.reconnect || args.compress) && (in_fd == sockfd || out_fd == sockfd)) return 1;
+
+  // The lines have to be captured, or are played back from a capture file
+  if(args.capture_path || in_fd == -1) return 1;
+
+  int status = 1;
+
+  if(args.raw) status = splice_relay(in_fd, out_fd, args.debug);
+
+  if(args.uring && status == 1) status = uring_relay(in_fd, out_fd, args.debug);
+
+  return (status <= 1) ? status : 2;
+}
+
+/*
+ * Relay length-prefixed frames from reader to writer
+ *
+ * The payload of every frame is streamed in chunks, straight from the
+ * receive buffer to the send buffer, so frames of any size are relayed
+ * and the payload can contain newlines and NUL bytes
+ *
+ * PARAMS
+ * - const char* label | Label of the debug messages, or NULL for no messages
+ *
+ * RETURN (int status)
+ * -  0 | Success, end of file
+ * - -1 | Failed to relay, or the input ended within a frame
+ */
+static int frame_relay(struct reader* reader, struct writer* writer, const char* label)
+{
+  uint32_t length;
+
+  int status;
+
+  while((status = reader_frame_header_read(reader, &length)) == 1)
+  {
+    if(args.debug && label)
+    {
+      debug_print(stdout, label, "Frame of %ld bytes", (long) length);
+    }
+
+    if(writer_frame_header_write(writer, length) == -1) return -1;
+
+    while(length > 0)
+    {
+      const char* chunk;
+
+      ssize_t chunk_size = reader_chunk_read(reader, &chunk, length);
+
+      if(chunk_size <= 0) return -1;
+
+      if(writer_write(writer, chunk, chunk_size) == -1) return -1;
+
+      length -= chunk_size;
+    }
+
+    // Send the batch of frames when the next read might block
+    if(!reader_frame_pending(reader) && writer_flush(writer) == -1) return -1;
+  }
+
+  if(writer_flush(writer) == -1) return -1;
+
+  return status;
+}
+
+/*
+ * The reader stage of a routine, running on its own thread
+ */
+struct stage
+{
+  pthread_t      thread;
+  struct reader* reader;
+  struct queue   queue;
+};
+
+/*
+ * Reader stage - read lines into the slots of the queue,
+ * until end of file or until the stage is stopped
+ */
+static void* reader_stage_routine(void* arg)
+{
+  struct stage* stage = arg;
+
+  struct queue_slot* slot;
+
+  while((slot = queue_slot_claim(&stage->queue)))
+  {
+    ssize_t read_size = reader_line_read(stage->reader, slot->data, QUEUE_SLOT_SIZE - 1);
+
+    if(read_size <= 0) break;
+
+    // IMPORTANT: Terminate string after reading bytes
+    slot->data[read_size] = '\0';
+
+    slot->length = read_size;
+
+    queue_slot_push(&stage->queue);
+
+    // Hand over the batch of lines when the next read might block
+    if(!reader_line_pending(stage->reader)) queue_flush(&stage->queue);
+  }
+
+  if(errno != 0 && errno != EINTR)
+  {
+    if(args.debug) error_print("Reader stage: %s", strerror(errno));
+  }
+
+  queue_close(&stage->queue);
+
+  return NULL;
+}
+
+/*
+ * Relay lines from reader to writer with a reader stage and a writer stage,
+ * so that a slow writer doesn't stall the reads, until the queue is full
+ *
+ * The calling thread is the writer stage
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to start the reader stage
+ */
+static int stage_relay(struct reader* reader, struct writer* writer, ssize_t (*write) (struct writer*, const char*, size_t))
+{
+  struct stage stage = { .reader = reader };
+
+  if(queue_create(&stage.queue) == -1) return -1;
+
+  if(pthread_create(&stage.thread, NULL, reader_stage_routine, &stage) != 0)
+  {
+    queue_free(&stage.queue);
+
+    return -1;
+  }
+
+  struct queue_slot* slot;
+
+  while((slot = queue_slot_peek(&stage.queue)))
+  {
+    if(write(writer, slot->data, slot->length) <= 0) break;
+
+    queue_slot_release(&stage.queue);
+
+    // Send the batch of lines when the next peek might block
+    if(!queue_pending(&stage.queue) && writer_flush(writer) == -1) break;
+  }
+
+  writer_flush(writer);
+
+  int error = errno;
+
+  queue_stop(&stage.queue);
+
+  // Interrupt the reader stage until it has ended,
+  // in case it is blocked reading or missed the signal
+  struct timespec deadline;
+
+  do
+  {
+    pthread_kill(stage.thread, SIGUSR1);
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+
+    deadline.tv_nsec += 10000000L;
+
+    if(deadline.tv_nsec >= 1000000000L)
+    {
+      deadline.tv_sec++;
+
+      deadline.tv_nsec -= 1000000000L;
+    }
   }
-} 
+  while(pthread_timedjoin_np(stage.thread, NULL, &deadline) != 0);
+
+  queue_free(&stage.queue);
+
+  errno = error;
+
+  return 0;
+}
+
+/*
+ * Sleep between reconnect attempts
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Interrupted
+ */
+static int reconnect_sleep(int delay)
+{
+  struct timespec time = { .tv_sec = delay / 1000, .tv_nsec = (delay % 1000) * 1000000L };
+
+  return nanosleep(&time, NULL);
+}
+
+/*
+ * Replace the lost connection with a new one, and replay the lines
+ * that the peer has not acknowledged over it
+ *
+ * The server accepts a new client, and the client connects to the server again,
+ * waiting longer and longer between the attempts (exponential backoff)
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Interrupted, or the stdin routine has ended
+ */
+static int socket_reconnect(void)
+{
+  replay_link_down(args.debug);
+
+  socket_close(&sockfd, args.debug);
+
+  int delay = RECONNECT_DELAY_MIN;
+
+  while(stdin_running)
+  {
+    errno = 0;
+
+    int newfd;
+
+    if(servfd != -1) newfd = socket_accept(servfd, args.debug);
+
+    else if(args.unix_path) newfd = client_unix_socket_connect(args.unix_path, args.debug);
+
+    else newfd = client_socket_connect(args.address, args.port, args.debug);
+
+    if(newfd != -1 && replay_link_up(newfd, args.debug) == 0)
+    {
+      sockfd = newfd;
+
+      errno = 0;
+
+      return 0;
+    }
+
+    if(errno == EINTR) return -1;
+
+    socket_close(&newfd, args.debug);
+
+    if(args.debug) info_print("Reconnecting in %d ms", delay);
+
+    if(reconnect_sleep(delay) == -1) return -1;
+
+    delay = (delay * 2 < RECONNECT_DELAY_MAX) ? delay * 2 : RECONNECT_DELAY_MAX;
+  }
+
+  return -1;
+}
 
 /*
  * stdout routine - process that handles one way communication (usually output)
@@ -216,23 +954,88 @@ static ssize_t stdout_thread_write(const char* buffer, size_t size)
  */
 void* stdout_routine(void* arg)
 {
-  if(stdin_fifo == -1 && sockfd == -1) return NULL;
+  if(!args.stdin_path && sockfd == -1) return NULL;
 
 
   if(args.debug) info_print("Start of stdout routine");
 
   stdout_running = true;
 
-  char buffer[1024];
+  struct reader reader;
 
-  int read_size = -1, write_size = -1;
+  struct writer writer;
 
-  while((read_size = stdout_thread_read(buffer, sizeof(buffer) - 1)) > 0)
+  if(stdout_thread_reader_init(&reader) == -1)
   {
-    // IMPORTANT: Terminate string after reading bytes
-    buffer[read_size] = '\0';
+    if(args.debug) error_print("Failed to initialize stdout reader");
+
+    stdout_running = false;
+
+    return NULL;
+  }
+
+  if(stdout_thread_writer_init(&writer) == -1)
+  {
+    if(args.debug) error_print("Failed to initialize stdout writer");
 
-    if((write_size = stdout_thread_write(buffer, sizeof(buffer))) <= 0) break;
+    reader_free(&reader);
+
+    stdout_running = false;
+
+    return NULL;
+  }
+
+  struct direction* direction = routine_counters_attach(&reader, &writer);
+
+  // In raw or uring mode, the bytes are relayed without framing,
+  // if the endpoints allow it, else fall back to the buffered relay
+  int status = fast_relay(reader.fd, writer.fd);
+
+  if(status == 1 && args.binary)
+  {
+    frame_relay(&reader, &writer, (args.stdout_path && sockfd != -1) ? "SOCKET => FIFO" : NULL);
+  }
+  else if(status == 1 && args.stages)
+  {
+    stage_relay(&reader, &writer, stdout_thread_write);
+  }
+  else if(status == 1)
+  {
+    const char* lines;
+
+    ssize_t read_size = -1, write_size = -1;
+
+    long mark = routine_frame_mark(&reader, &writer);
+
+    // In reconnect mode, the peer sends the partial line of a lost connection again,
+    // so the part that was received must not be written
+    reader.drop_tail = args.reconnect && reader.fd == sockfd;
+
+    while(true)
+    {
+      // The lines are handed out in chunks, straight from the receive buffer,
+      // and a line longer than the buffer is streamed as several chunks
+      while((read_size = reader_lines_read(&reader, &lines, reader.size)) > 0)
+      {
+        if((write_size = stdout_thread_write(&writer, lines, read_size)) <= 0) break;
+
+        routine_frame_record(direction, &reader, &writer, &mark);
+
+        // Send the batch of lines when the next read might block
+        if(!reader_line_pending(&reader) && writer_flush(&writer) == -1) break;
+      }
+
+      writer_flush(&writer);
+
+      // In reconnect mode, a lost connection is replaced by a new one,
+      // and the partial line of the lost connection, which was dropped by the reader
+      // or is dropped by the reset, is replayed by the peer
+      if(read_size > 0 || !args.reconnect || reader.fd != sockfd || errno == EINTR) break;
+
+      if(socket_reconnect() == -1) break;
+
+      reader_fd_reset(&reader, sockfd);
+    }
   }
 
   if(errno != 0)
@@ -240,6 +1043,12 @@ void* stdout_routine(void* arg)
     if(args.debug) error_print("%s", strerror(errno));
   }
 
+  if(args.debug) routine_stats_print("stdout routine", &reader, &writer);
+
+  reader_free(&reader);
+
+  writer_free(&writer);
+
   if(stdin_running)
   {
     if(args.debug) info_print("Interrupting stdin routine");
@@ -264,23 +1073,79 @@ void* stdout_routine(void* arg)
  */
 void* stdin_routine(void* arg)
 {
-  if(stdin_fifo != -1 && sockfd == -1 && stdout_fifo == -1) return NULL;
+  if(args.stdin_path && sockfd == -1 && !args.stdout_path) return NULL;
 
 
   if(args.debug) info_print("Start of stdin routine");
 
   stdin_running = true;
 
-  char buffer[1024];
+  struct reader reader;
 
-  int read_size = -1, write_size = -1;
+  struct writer writer;
 
-  while((read_size = stdin_thread_read(buffer, sizeof(buffer) - 1)) > 0)
+  if(stdin_thread_reader_init(&reader) == -1)
   {
-    // IMPORTANT: Terminate string after reading bytes
-    buffer[read_size] = '\0';
+    if(args.debug) error_print("Failed to initialize stdin reader");
+
+    stdin_running = false;
 
-    if((write_size = stdin_thread_write(buffer, sizeof(buffer))) <= 0) break;
+    return NULL;
+  }
+
+  if(stdin_thread_writer_init(&writer) == -1)
+  {
+    if(args.debug) error_print("Failed to initialize stdin writer");
+
+    reader_free(&reader);
+
+    stdin_running = false;
+
+    return NULL;
+  }
+
+  struct direction* direction = routine_counters_attach(&reader, &writer);
+
+  // In raw or uring mode, the bytes are relayed without framing,
+  // if the endpoints allow it, else fall back to the buffered relay
+  int status = fast_relay(reader.fd, writer.fd);
+
+  if(status == 1 && args.binary)
+  {
+    frame_relay(&reader, &writer, (args.stdin_path && sockfd != -1) ? "FIFO => SOCKET" : NULL);
+  }
+  else if(status == 1 && args.stages)
+  {
+    stage_relay(&reader, &writer, stdin_thread_write);
+  }
+  else if(status == 1)
+  {
+    const char* lines;
+
+    ssize_t read_size = -1, write_size = -1;
+
+    long mark = routine_frame_mark(&reader, &writer);
+
+    struct batch batch;
+
+    batch_init(&batch, args.batch_bytes, args.batch_lines, args.batch_window);
+
+    // The lines are handed out in chunks, straight from the receive buffer,
+    // and a line longer than the buffer is streamed as several chunks
+    while((read_size = batch_lines_read(&batch, &reader, &writer, &lines)) > 0)
+    {
+      if((write_size = stdin_thread_write(&writer, lines, read_size)) <= 0) break;
+
+      routine_frame_record(direction, &reader, &writer, &mark);
+
+      // Send the batch of lines when it is full, or when the next read might block
+      // and no more lines arrive within the batching window
+      if(batch_flush(&batch, &reader, &writer) == -1) break;
+    }
+
+    batch_send(&batch, &writer);
+
+    if(args.batch) batch_report(&batch, "stdin routine");
   }
 
   if(errno != 0)
@@ -288,6 +1153,12 @@ void* stdin_routine(void* arg)
     if(args.debug) error_print("%s", strerror(errno));
   }
 
+  if(args.debug) routine_stats_print("stdin routine", &reader, &writer);
+
+  reader_free(&reader);
+
+  writer_free(&writer);
+
   if(stdout_running)
   {
     if(args.debug) info_print("Interrupting stdout routine");
@@ -302,6 +1173,118 @@ void* stdin_routine(void* arg)
   return NULL;
 }
 
+/*
+ * Initialize relay for the event loop, using the routing of a thread
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to initialize reader or writer
+ */
+static int event_relay_init(struct relay* relay, int (*reader_init) (struct reader*), int (*writer_init) (struct writer*), ssize_t (*write) (struct writer*, const char*, size_t))
+{
+  if(reader_init(&relay->reader) == -1) return -1;
+
+  if(writer_init(&relay->writer) == -1)
+  {
+    reader_free(&relay->reader);
+
+    return -1;
+  }
+
+  relay->write = write;
+
+  return 0;
+}
+
+/*
+ * event routine - handles both directions of communication from a single thread
+ *
+ * Instead of a stdin and a stdout thread, the same relays are driven
+ * by an epoll event loop, using non-blocking I/O
+ *
+ * If a server was created, the client is accepted on the event loop
+ */
+static void event_routine(void)
+{
+  // The relays are driven by the same thread, so they start once both fifos have their peers
+  if(args_fifos_open() == -1) return;
+
+  int epollfd = event_loop_create(args.debug);
+
+  if(epollfd == -1) return;
+
+  if(sockfd == -1 && servfd != -1 && event_socket_accept(epollfd, &sockfd, servfd, args.debug) == -1)
+  {
+    event_loop_close(&epollfd, args.debug);
+
+    return;
+  }
+
+  struct relay relays[2];
+
+  const char* names[2];
+
+  int count = 0;
+
+  // Same conditions as for running the stdin and stdout routines
+  if(!(args.stdin_path && sockfd == -1 && !args.stdout_path))
+  {
+    if(event_relay_init(&relays[count], stdin_thread_reader_init, stdin_thread_writer_init, stdin_thread_write) == 0)
+    {
+      routine_counters_attach(&relays[count].reader, &relays[count].writer);
+
+      names[count++] = "stdin relay";
+    }
+    else if(args.debug) error_print("Failed to initialize stdin relay");
+  }
+
+  if(args.stdin_path || sockfd != -1)
+  {
+    if(event_relay_init(&relays[count], stdout_thread_reader_init, stdout_thread_writer_init, stdout_thread_write) == 0)
+    {
+      routine_counters_attach(&relays[count].reader, &relays[count].writer);
+
+      names[count++] = "stdout relay";
+    }
+    else if(args.debug) error_print("Failed to initialize stdout relay");
+  }
+
+  event_loop_run(epollfd, relays, count, args.debug);
+
+  for(int index = 0; index < count; index++)
+  {
+    if(args.debug) routine_stats_print(names[index], &relays[index].reader, &relays[index].writer);
+
+    reader_free(&relays[index].reader);
+
+    writer_free(&relays[index].writer);
+  }
+
+  event_loop_close(&epollfd, args.debug);
+}
+
+/*
+ * hub routine - broadcasts lines between any number of clients
+ *
+ * The hub reads from either [stdin fifo] or [stdin],
+ * and writes the lines of the clients to either [stdout fifo] or [stdout]
+ *
+ * In topics mode, lines are only routed to the clients subscribed to their topic
+ */
+static void hub_routine(void)
+{
+  // The input is waited for on the event loop of the hub, so only the output waits for its peer
+  if(args.stdin_path && fifo_open_nonblock(&stdin_fifo, args.stdin_path, O_RDONLY, args.debug) == -1) return;
+
+  if(routine_fifo_open(&stdout_fifo, args.stdout_path, O_WRONLY) == -1) return;
+
+  int in_fd  = (stdin_fifo  != -1) ? stdin_fifo  : 0;
+
+  int out_fd = (stdout_fifo != -1) ? stdout_fifo : 1;
+
+  hub_run(servfd, in_fd, out_fd, args.topics, args.debug);
+}
+
 /*
  * Keyboard interrupt - close the program (the threads)
  */
@@ -368,18 +1351,118 @@ static void signals_handler_setup(void)
  * RETURN (same as client_or_server_socket_create)
  * - 0 | Success
  * - 1 | Failed to create socket
+ * - 3 | Failed to create shared memory rings
+ * - 4 | Failed to create replay buffer
+ * - 5 | Failed to negotiate compression
  *
  * Note: Success can be omitted, without a socket being created
  */
 static int args_socket_create(void)
 {
+  // Peers on the same host can use a unix socket instead
+  if(args.unix_path)
+  {
+    if(args.hub)
+    {
+      return client_or_server_unix_socket_open(&sockfd, &servfd, args.unix_path, SOMAXCONN, args.debug);
+    }
+
+    if(args.epoll)
+    {
+      return client_or_server_unix_socket_open(&sockfd, &servfd, args.unix_path, 1, args.debug);
+    }
+
+    int status = client_or_server_unix_socket_create(&sockfd, &servfd, args.unix_path, args.debug);
+
+    // The server passes the shared memory rings to the client
+    if(status == 0 && args.shm && shm_create(sockfd, servfd != -1, args.debug) == -1) return 3;
+
+    if(status == 0 && args.reconnect && replay_create(sockfd, REPLAY_SIZE, args.debug) == -1) return 4;
+
+    if(status == 0 && args.compress && compress_create(sockfd, args.debug) == -1) return 5;
+
+    return status;
+  }
+
   if(!args.address && args.port == -1) return 0;
 
   if(!args.address)   args.address = DEFAULT_ADDRESS;
 
   if(args.port == -1) args.port    = DEFAULT_PORT;
 
-  return client_or_server_socket_create(&sockfd, &servfd, args.address, args.port, args.debug);
+  // The hub accepts its clients by itself
+  if(args.hub)
+  {
+    return client_or_server_socket_open(&sockfd, &servfd, args.address, args.port, SOMAXCONN, args.debug);
+  }
+
+  // The event loop accepts the client by itself
+  if(args.epoll)
+  {
+    return client_or_server_socket_open(&sockfd, &servfd, args.address, args.port, 1, args.debug);
+  }
+
+  int status = client_or_server_socket_create(&sockfd, &servfd, args.address, args.port, args.debug);
+
+  // The lines sent over the socket are kept until the peer acknowledges them
+  if(status == 0 && args.reconnect && replay_create(sockfd, REPLAY_SIZE, args.debug) == -1) return 4;
+
+  // Both peers agree on a codec before the first line is sent
+  if(status == 0 && args.compress && compress_create(sockfd, args.debug) == -1) return 5;
+
+  return status;
+}
+
+/*
+ * Preallocate the message pool, with the blocks that the requested modes need
+ *
+ * RETURN (same as pool_create)
+ */
+static int args_pool_create(void)
+{
+  size_t counts[POOL_CLASSES] = POOL_COUNTS;
+
+  // The queues of the stages and the replay buffer use the largest class
+  if(args.stages)    counts[POOL_CLASSES - 1] += 2;
+
+  if(args.reconnect) counts[POOL_CLASSES - 1] += 1;
+
+  // The compressor has a batch buffer and two block buffers
+  if(args.compress)
+  {
+    counts[3] += 1;
+    counts[4] += 2;
+  }
+
+  // Every channel has a reader and a writer, and so does the connection
+  if(args.mux) counts[3] += 2 + 2 * mux_channel_count();
+
+  // Every hub client has a small struct, a reader and a writer,
+  // and a long line borrows a buffer while it is collected
+  if(args.hub)
+  {
+    counts[0] += HUB_POOL_CLIENTS;
+    counts[2] += HUB_POOL_CLIENTS;
+    counts[3] += HUB_POOL_CLIENTS + HUB_POOL_PARTIALS;
+  }
+
+  return pool_create(counts, args.hugepages, args.debug);
+}
+
+/*
+ * Open the capture file to record to, and the capture file to play back
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to open a capture file
+ */
+static int args_capture_open(void)
+{
+  if(args.capture_path && capture_create(args.capture_path, args.debug) == -1) return -1;
+
+  if(args.play_path && capture_play_open(args.play_path, CAPTURE_STDIN, args.play_fast, args.debug) == -1) return -1;
+
+  return 0;
 }
 
 static struct argp argp = { options, opt_parse, args_doc, doc };
@@ -391,28 +1474,69 @@ int main(int argc, char* argv[])
 {
   argp_parse(&argp, argc, argv, 0, 0, &args);
 
+  // The messages are formatted and written by the logger thread, off the relay threads
+  if(args.debug) log_start();
+
   signals_handler_setup();
 
+  // The counters and latencies are printed on SIGUSR2, by a thread of their own
+  directions_dump_start(args.debug);
+
+  // Without the pool, the buffers are allocated with malloc
+  args_pool_create();
 
-  if(args_socket_create() == 0)
+
+  // The fifos start with the default capacity, and are grown while they are running
+  if(args.pipe_size) fifo_pipe_limit_set(args.pipe_size);
+
+  // The fifos are opened by the routines, every routine as soon as its peers show up
+  if(args_capture_open() == 0 && args_socket_create() == 0)
   {
-    if(stdin_stdout_fifo_open(&stdin_fifo, args.stdin_path, &stdout_fifo, args.stdout_path, fifo_reverse, args.debug) == 0)
-    {
-      stdin_stdout_thread_start(&stdin_thread, &stdin_routine, &stdout_thread, &stdout_routine, args.debug);
-    }
+    // If a hub was requested and no hub was running, become the hub
+    if(args.hub && servfd != -1) hub_routine();
+
+    else if(args.mux) mux_run(sockfd, args.debug);
+
+    else if(args.epoll) event_routine();
+
+    else stdin_stdout_thread_start(&stdin_thread, &stdin_routine, &stdout_thread, &stdout_routine, args.debug);
   }
 
+  // The percentiles are printed at exit, and on SIGUSR2 while running
+  if(args.latency) directions_print();
+
 
   fifo_close(&stdin_fifo, args.debug);
 
   fifo_close(&stdout_fifo, args.debug);
 
+  shm_close(args.debug);
+
+  replay_free(args.debug);
+
+  compress_free(args.debug);
+
+  capture_close(args.debug);
+
+  capture_play_close(args.debug);
+
   socket_close(&sockfd, args.debug);
 
-  socket_close(&servfd, args.debug);
+  // The server removes its unix socket file
+  if(args.unix_path && servfd != -1)
+  {
+    socket_close(&servfd, args.debug);
 
+    unix_socket_unlink(args.unix_path, args.debug);
+  }
+  else socket_close(&servfd, args.debug);
+
+
+  pool_free(args.debug);
 
   if(args.debug) info_print("End of main");
 
+  log_stop();
+
   return 0;
 }
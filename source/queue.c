@@ -0,0 +1,236 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#include "queue.h"
+
+/*
+ * Create the queue, pre-allocating all of its slots from the message pool
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to allocate slots
+ */
+int queue_create(struct queue* queue)
+{
+  queue->slots = pool_alloc(sizeof(struct queue_slot) * QUEUE_SLOTS);
+
+  if(!queue->slots) return -1;
+
+  queue->head             = 0;
+  queue->published        = 0;
+  queue->producer_waiting = 0;
+  queue->closed           = false;
+
+  queue->tail             = 0;
+  queue->released         = 0;
+  queue->consumer_waiting = 0;
+
+  queue->stopped          = false;
+
+  // Spinning only pays off if the other stage runs on another cpu at the same time
+  queue->spins = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? QUEUE_SPINS : 0;
+
+  return 0;
+}
+
+/*
+ * Free the slots of the queue
+ */
+void queue_free(struct queue* queue)
+{
+  pool_release(queue->slots);
+
+  queue->slots = NULL;
+}
+
+/*
+ * Wake up the other stage, if it is sleeping on the futex
+ */
+static void queue_wake(uint32_t* waiting)
+{
+  if(__atomic_load_n(waiting, __ATOMIC_SEQ_CST) == 1 && __atomic_exchange_n(waiting, 0, __ATOMIC_SEQ_CST) == 1)
+  {
+    syscall(SYS_futex, waiting, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+  }
+}
+
+/*
+ * Wait until ready returns true, first by spinning, and then by sleeping
+ * on the futex until the other stage wakes us up
+ *
+ * RETURN (int status)
+ * -  0 | Success, ready
+ * - -1 | Interrupted, or the queue is stopped
+ */
+static int queue_wait(struct queue* queue, uint32_t* waiting, bool (*ready) (struct queue*))
+{
+  for(int spin = 0; spin < queue->spins; spin++)
+  {
+    if(ready(queue)) return 0;
+  }
+
+  struct timespec timeout = { .tv_sec = 0, .tv_nsec = QUEUE_TIMEOUT * 1000000L };
+
+  while(!__atomic_load_n(&queue->stopped, __ATOMIC_ACQUIRE))
+  {
+    __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+
+    // Check again, in case the other stage was done before it saw the flag
+    if(ready(queue))
+    {
+      __atomic_store_n(waiting, 0, __ATOMIC_SEQ_CST);
+
+      return 0;
+    }
+
+    if(syscall(SYS_futex, waiting, FUTEX_WAIT_PRIVATE, 1, &timeout, NULL, 0) == -1)
+    {
+      if(errno == EINTR) return -1;
+
+      errno = 0; // EAGAIN (woken before sleeping) or ETIMEDOUT
+    }
+
+    if(ready(queue)) return 0;
+  }
+
+  return -1;
+}
+
+/*
+ * There is a free slot for the producer
+ */
+static bool queue_space_ready(struct queue* queue)
+{
+  return queue->head - __atomic_load_n(&queue->released, __ATOMIC_ACQUIRE) < QUEUE_SLOTS;
+}
+
+/*
+ * There is a filled slot for the consumer, or the producer is done
+ */
+static bool queue_slot_ready(struct queue* queue)
+{
+  return __atomic_load_n(&queue->published, __ATOMIC_ACQUIRE) != queue->tail ||
+         __atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Make the pushed slots visible to the consumer, waking it up if it sleeps
+ */
+void queue_flush(struct queue* queue)
+{
+  if(queue->published == queue->head) return;
+
+  __atomic_store_n(&queue->published, queue->head, __ATOMIC_SEQ_CST);
+
+  queue_wake(&queue->consumer_waiting);
+}
+
+/*
+ * Claim the next free slot, to be filled by the producer
+ *
+ * If the queue is full, the pushed slots are flushed,
+ * before waiting for the consumer to release a slot
+ *
+ * RETURN (struct queue_slot* slot)
+ * - !NULL | Success
+ * -  NULL | Interrupted, or the queue is stopped
+ */
+struct queue_slot* queue_slot_claim(struct queue* queue)
+{
+  if(!queue_space_ready(queue))
+  {
+    queue_flush(queue);
+
+    if(queue_wait(queue, &queue->producer_waiting, queue_space_ready) == -1) return NULL;
+  }
+
+  return &queue->slots[queue->head & (QUEUE_SLOTS - 1)];
+}
+
+/*
+ * Push the claimed slot, after it has been filled
+ *
+ * The consumer is woken up once per batch of slots
+ */
+void queue_slot_push(struct queue* queue)
+{
+  queue->head++;
+
+  if(queue->head - queue->published >= QUEUE_BATCH) queue_flush(queue);
+}
+
+/*
+ * Tell the consumer that nothing more will be pushed
+ */
+void queue_close(struct queue* queue)
+{
+  queue_flush(queue);
+
+  __atomic_store_n(&queue->closed, true, __ATOMIC_SEQ_CST);
+
+  queue_wake(&queue->consumer_waiting);
+}
+
+/*
+ * Get the next filled slot, to be emptied by the consumer
+ *
+ * RETURN (struct queue_slot* slot)
+ * - !NULL | Success
+ * -  NULL | The producer is done, interrupted, or the queue is stopped
+ */
+struct queue_slot* queue_slot_peek(struct queue* queue)
+{
+  if(__atomic_load_n(&queue->published, __ATOMIC_ACQUIRE) == queue->tail)
+  {
+    // Release all emptied slots, before waiting for the producer
+    __atomic_store_n(&queue->released, queue->tail, __ATOMIC_SEQ_CST);
+
+    queue_wake(&queue->producer_waiting);
+
+    if(queue_wait(queue, &queue->consumer_waiting, queue_slot_ready) == -1) return NULL;
+
+    if(__atomic_load_n(&queue->published, __ATOMIC_ACQUIRE) == queue->tail) return NULL; // Closed
+  }
+
+  return &queue->slots[queue->tail & (QUEUE_SLOTS - 1)];
+}
+
+/*
+ * Release the peeked slot, after it has been emptied
+ *
+ * The producer is woken up once per batch of slots
+ */
+void queue_slot_release(struct queue* queue)
+{
+  queue->tail++;
+
+  if(queue->tail - queue->released >= QUEUE_BATCH)
+  {
+    __atomic_store_n(&queue->released, queue->tail, __ATOMIC_SEQ_CST);
+
+    queue_wake(&queue->producer_waiting);
+  }
+}
+
+/*
+ * Check if a filled slot is waiting, meaning that the next peek will not block
+ */
+bool queue_pending(struct queue* queue)
+{
+  return __atomic_load_n(&queue->published, __ATOMIC_ACQUIRE) != queue->tail;
+}
+
+/*
+ * Make both stages give up waiting on the queue
+ */
+void queue_stop(struct queue* queue)
+{
+  __atomic_store_n(&queue->stopped, true, __ATOMIC_SEQ_CST);
+
+  queue_wake(&queue->producer_waiting);
+
+  queue_wake(&queue->consumer_waiting);
+}
@@ -0,0 +1,78 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include "debug.h"
+#include "pool.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define QUEUE_SLOTS     1024 // Has to be a power of two
+#define QUEUE_SLOT_SIZE 1024
+#define QUEUE_BATCH     32   // Slots between wakeups of the other stage
+#define QUEUE_SPINS     4096
+#define QUEUE_TIMEOUT   100  // Milliseconds between checks for stop
+
+/*
+ * Pre-allocated message slot, holding one line
+ */
+struct queue_slot
+{
+  size_t length;
+  char   data[QUEUE_SLOT_SIZE];
+};
+
+/*
+ * Bounded single producer, single consumer queue between two stages
+ *
+ * The producer and the consumer fields are on separate cache lines
+ */
+struct queue
+{
+  size_t             head      __attribute__((aligned(64))); // Written by producer
+  size_t             published;
+  uint32_t           producer_waiting;
+  bool               closed;
+
+  size_t             tail      __attribute__((aligned(64))); // Written by consumer
+  size_t             released;
+  uint32_t           consumer_waiting;
+
+  struct queue_slot* slots     __attribute__((aligned(64)));
+  int                spins;
+  bool               stopped;
+};
+
+extern int                queue_create(struct queue* queue);
+
+extern void               queue_free(struct queue* queue);
+
+extern struct queue_slot* queue_slot_claim(struct queue* queue);
+
+extern void               queue_slot_push(struct queue* queue);
+
+extern void               queue_flush(struct queue* queue);
+
+extern void               queue_close(struct queue* queue);
+
+extern struct queue_slot* queue_slot_peek(struct queue* queue);
+
+extern void               queue_slot_release(struct queue* queue);
+
+extern bool               queue_pending(struct queue* queue);
+
+extern void               queue_stop(struct queue* queue);
+
+#endif // QUEUE_H
@@ -0,0 +1,453 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#define _GNU_SOURCE
+
+#include "reader.h"
+
+/*
+ * Initialize reader for an endpoint, allocating its receive buffer from the message pool
+ *
+ * PARAMS
+ * - int fd       | File descriptor of the endpoint
+ * - ssize_t fill | Function reading a chunk from the endpoint (buffer_read or socket_read)
+ * - size_t size  | Size of the receive buffer
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to allocate receive buffer
+ */
+int reader_init(struct reader* reader, int fd, ssize_t (*fill) (int, char*, size_t), size_t size)
+{
+  reader->buffer = pool_alloc(size);
+
+  if(!reader->buffer) return -1;
+
+  reader->fd       = fd;
+  reader->fill     = fill;
+  reader->size     = size;
+  reader->start    = 0;
+  reader->end      = 0;
+  reader->syscalls = 0;
+  reader->lines    = 0;
+  reader->drop_tail = false;
+  reader->counters  = NULL;
+  reader->histogram = NULL;
+  reader->blocked   = 0;
+
+  return 0;
+}
+
+/*
+ * Free the receive buffer of reader
+ */
+void reader_free(struct reader* reader)
+{
+  pool_release(reader->buffer);
+
+  reader->buffer = NULL;
+}
+
+/*
+ * Switch the reader to a new endpoint, like a new connection,
+ * dropping the bytes that were left from the old endpoint
+ */
+void reader_fd_reset(struct reader* reader, int fd)
+{
+  reader->fd    = fd;
+  reader->start = 0;
+  reader->end   = 0;
+}
+
+/*
+ * Move the partial line to the start of the buffer,
+ * to make room for the next chunk
+ */
+static void reader_compact(struct reader* reader)
+{
+  if(reader->start == 0) return;
+
+  memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+
+  reader->end  -= reader->start;
+  reader->start = 0;
+}
+
+/*
+ * Pull the next chunk from the endpoint into the receive buffer
+ *
+ * RETURN (same as fill)
+ */
+static ssize_t reader_fill(struct reader* reader)
+{
+  long start = reader->histogram ? histogram_time() : 0;
+
+  ssize_t status = reader->fill(reader->fd, reader->buffer + reader->end, reader->size - reader->end);
+
+  if(reader->histogram)
+  {
+    long elapsed = histogram_time() - start;
+
+    reader->blocked += elapsed;
+
+    histogram_record(reader->histogram, elapsed);
+  }
+
+  reader->syscalls++;
+
+  COUNTER_ADD(reader->counters, syscalls, 1);
+
+  if(status > 0) COUNTER_ADD(reader->counters, bytes, status);
+
+  // Interrupts are how the routines are stopped, not errors
+  else if(status == -1 && errno != EINTR)
+  {
+    if(errno == EAGAIN || errno == EWOULDBLOCK) COUNTER_ADD(reader->counters, eagains, 1);
+
+    else COUNTER_ADD(reader->counters, errors, 1);
+  }
+
+  return status;
+}
+
+/*
+ * Count a line (or a frame) that was read
+ */
+static void reader_line_count(struct reader* reader)
+{
+  reader->lines++;
+
+  COUNTER_ADD(reader->counters, lines, 1);
+}
+
+/*
+ * Hand out bytes from the receive buffer to the caller's buffer
+ *
+ * RETURN (ssize_t size)
+ * - The number of handed out bytes
+ */
+static ssize_t reader_take(struct reader* reader, char* buffer, size_t size)
+{
+  memcpy(buffer, reader->buffer + reader->start, size);
+
+  reader->start += size;
+
+  if(reader->start == reader->end)
+  {
+    reader->start = 0;
+    reader->end   = 0;
+  }
+
+  return size;
+}
+
+/*
+ * Read a single line from the endpoint, using the receive buffer
+ *
+ * If the line doesn't fit in the buffer, the first part of it is returned,
+ * and the rest of it is returned by the next call
+ *
+ * RETURN (ssize_t size)
+ * - >0 | Success! The length of the read line
+ * -  0 | End of File
+ * - -1 | Failed to read from endpoint
+ */
+ssize_t reader_line_read(struct reader* reader, char* buffer, size_t size)
+{
+  if(!buffer || size == 0) return 0;
+
+  while(true)
+  {
+    size_t length = reader->end - reader->start;
+
+    char* newline = memchr(reader->buffer + reader->start, '\n', length);
+
+    if(newline)
+    {
+      size_t line_size = (newline - (reader->buffer + reader->start)) + 1;
+
+      if(line_size <= size) reader_line_count(reader);
+
+      return reader_take(reader, buffer, (line_size < size) ? line_size : size);
+    }
+
+    // The caller's buffer is full, hand out the first part of the line
+    if(length >= size || length == reader->size)
+    {
+      return reader_take(reader, buffer, (length < size) ? length : size);
+    }
+
+    reader_compact(reader);
+
+    ssize_t status = reader_fill(reader);
+
+    if(status == -1) return -1; // ERROR
+
+    if(status == 0)
+    {
+      // End Of File, but hand out the last unterminated line first
+      if(length > 0 && !reader->drop_tail) return reader_take(reader, buffer, length);
+
+      reader->start = 0;
+      reader->end   = 0;
+
+      return 0;
+    }
+
+    reader->end += status;
+  }
+}
+
+/*
+ * Check if a complete line is waiting in the receive buffer,
+ * meaning that the next read will not block
+ */
+bool reader_line_pending(const struct reader* reader)
+{
+  return memchr(reader->buffer + reader->start, '\n', reader->end - reader->start) != NULL;
+}
+
+/*
+ * Hand out lines from the receive buffer, without copying them, and count them
+ *
+ * RETURN (ssize_t size)
+ * - The number of handed out bytes
+ */
+static ssize_t reader_lines_take(struct reader* reader, const char** lines, size_t size)
+{
+  const char* start = reader->buffer + reader->start;
+
+  for(const char* line = start; (line = memchr(line, '\n', start + size - line)); line++)
+  {
+    reader_line_count(reader);
+  }
+
+  *lines = start;
+
+  reader->start += size;
+
+  return size;
+}
+
+/*
+ * Find the end of the last complete line in the bytes, stopping after count lines
+ *
+ * RETURN (const char* newline)
+ * - The newline that ends the lines, or NULL if there is no complete line
+ */
+static const char* reader_lines_end(const char* start, size_t length, size_t count)
+{
+  if(count == 0) return memrchr(start, '\n', length);
+
+  const char* newline = NULL;
+
+  for(const char* line = start; count > 0 && (line = memchr(line, '\n', start + length - line)); line++, count--)
+  {
+    newline = line;
+  }
+
+  return newline;
+}
+
+/*
+ * Hand out as many complete lines as fit in size bytes,
+ * without copying them out of the receive buffer
+ *
+ * If the first line doesn't fit in size bytes, or in the receive buffer,
+ * the first part of it is handed out, and the rest of it by the next call
+ *
+ * Note: The lines are only valid until the next call to the reader
+ *
+ * RETURN (ssize_t size)
+ * - >0 | Success! The length of the lines
+ * -  0 | End of File
+ * - -1 | Failed to read from endpoint
+ */
+ssize_t reader_lines_read(struct reader* reader, const char** lines, size_t size)
+{
+  return reader_lines_count_read(reader, lines, size, 0);
+}
+
+/*
+ * Hand out complete lines like reader_lines_read, but at most count of them
+ *
+ * PARAMS
+ * - size_t size  | The most bytes to hand out
+ * - size_t count | The most lines to hand out, or 0 for no limit
+ *
+ * RETURN (same as reader_lines_read)
+ */
+ssize_t reader_lines_count_read(struct reader* reader, const char** lines, size_t size, size_t count)
+{
+  if(!lines || size == 0) return 0;
+
+  while(true)
+  {
+    size_t length = reader->end - reader->start;
+
+    const char* start = reader->buffer + reader->start;
+
+    const char* newline = reader_lines_end(start, (length < size) ? length : size, count);
+
+    if(newline) return reader_lines_take(reader, lines, (newline - start) + 1);
+
+    if(length >= size || length == reader->size)
+    {
+      return reader_lines_take(reader, lines, (length < size) ? length : size);
+    }
+
+    reader_compact(reader);
+
+    ssize_t status = reader_fill(reader);
+
+    if(status == -1) return -1; // ERROR
+
+    if(status == 0)
+    {
+      // End Of File, but hand out the last unterminated line first
+      if(length > 0 && !reader->drop_tail) return reader_lines_take(reader, lines, length);
+
+      reader->start = 0;
+      reader->end   = 0;
+
+      return 0;
+    }
+
+    reader->end += status;
+  }
+}
+
+/*
+ * Fill the receive buffer until it holds at least size bytes
+ *
+ * RETURN (int status)
+ * -  1 | Success
+ * -  0 | End of File
+ * - -1 | Failed to read from endpoint
+ */
+static int reader_bytes_fill(struct reader* reader, size_t size)
+{
+  while(reader->end - reader->start < size)
+  {
+    reader_compact(reader);
+
+    ssize_t status = reader_fill(reader);
+
+    if(status == -1) return -1; // ERROR
+
+    if(status == 0) return 0; // End Of File
+
+    reader->end += status;
+  }
+
+  return 1;
+}
+
+/*
+ * Read the header of the next frame
+ *
+ * The payload has to be read with reader_chunk_read afterwards
+ *
+ * RETURN (int status)
+ * -  1 | Success! The payload length is stored in length
+ * -  0 | End of File
+ * - -1 | Failed to read from endpoint
+ */
+int reader_frame_header_read(struct reader* reader, uint32_t* length)
+{
+  int status = reader_bytes_fill(reader, FRAME_HEADER_SIZE);
+
+  if(status != 1) return status;
+
+  *length = frame_header_decode(reader->buffer + reader->start);
+
+  reader->start += FRAME_HEADER_SIZE;
+
+  reader_line_count(reader);
+
+  return 1;
+}
+
+/*
+ * Hand out the next chunk of bytes, of at most size bytes,
+ * without copying it out of the receive buffer
+ *
+ * Note: The chunk is only valid until the next call to the reader
+ *
+ * RETURN (ssize_t size)
+ * - >0 | Success! The length of the chunk
+ * -  0 | End of File
+ * - -1 | Failed to read from endpoint
+ */
+ssize_t reader_chunk_read(struct reader* reader, const char** chunk, size_t size)
+{
+  if(reader->start == reader->end)
+  {
+    reader->start = 0;
+    reader->end   = 0;
+
+    int status = reader_bytes_fill(reader, 1);
+
+    if(status != 1) return status;
+  }
+
+  size_t length = reader->end - reader->start;
+
+  if(length > size) length = size;
+
+  *chunk = reader->buffer + reader->start;
+
+  reader->start += length;
+
+  return length;
+}
+
+/*
+ * Check if a complete frame is waiting in the receive buffer,
+ * meaning that the next frame can be read without blocking
+ */
+bool reader_frame_pending(const struct reader* reader)
+{
+  size_t length = reader->end - reader->start;
+
+  if(length < FRAME_HEADER_SIZE) return false;
+
+  return frame_header_decode(reader->buffer + reader->start) <= length - FRAME_HEADER_SIZE;
+}
+
+/*
+ * Fill the receive buffer until a complete frame is waiting in it,
+ * for non-blocking endpoints
+ *
+ * RETURN (int status)
+ * -  1 | Success! The frame can be read without blocking
+ * -  0 | End of File
+ * - -1 | Failed to read from endpoint, or the frame doesn't fit in the buffer
+ */
+int reader_frame_fill(struct reader* reader)
+{
+  while(!reader_frame_pending(reader))
+  {
+    reader_compact(reader);
+
+    if(reader->end == reader->size)
+    {
+      errno = EMSGSIZE;
+
+      return -1;
+    }
+
+    ssize_t status = reader_fill(reader);
+
+    if(status == -1) return -1; // ERROR
+
+    if(status == 0) return 0; // End Of File
+
+    reader->end += status;
+  }
+
+  return 1;
+}
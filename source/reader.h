@@ -0,0 +1,79 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef READER_H
+#define READER_H
+
+#include "debug.h"
+#include "frame.h"
+#include "pool.h"
+#include "counter.h"
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define READER_SIZE 65536
+
+/*
+ * Buffered line reader (framer) for one endpoint
+ *
+ * Large chunks are pulled from the endpoint with a single call to fill,
+ * complete lines are handed out from the buffer and partial lines
+ * are kept for the next call
+ *
+ * In binary mode, the reader hands out length-prefixed frames instead,
+ * as a header followed by chunks of the payload
+ *
+ * If counters is set, the reader also counts its activity there,
+ * and if histogram is set, it records the time it waits in fill there
+ *
+ * If drop_tail is set, an unterminated last line is dropped at end of file,
+ * instead of being handed out, like when the peer will send it again
+ */
+struct reader
+{
+  int     fd;
+  ssize_t (*fill) (int, char*, size_t);
+  char*   buffer;
+  size_t  size;
+  size_t  start;
+  size_t  end;
+  size_t  syscalls;
+  size_t  lines;
+  bool    drop_tail;
+  struct counters* counters;
+  struct histogram* histogram;
+  long    blocked;
+};
+
+extern int     reader_init(struct reader* reader, int fd, ssize_t (*fill) (int, char*, size_t), size_t size);
+
+extern void    reader_free(struct reader* reader);
+
+extern void    reader_fd_reset(struct reader* reader, int fd);
+
+extern ssize_t reader_line_read(struct reader* reader, char* buffer, size_t size);
+
+extern bool    reader_line_pending(const struct reader* reader);
+
+extern ssize_t reader_lines_read(struct reader* reader, const char** lines, size_t size);
+
+extern ssize_t reader_lines_count_read(struct reader* reader, const char** lines, size_t size, size_t count);
+
+extern int     reader_frame_header_read(struct reader* reader, uint32_t* length);
+
+extern ssize_t reader_chunk_read(struct reader* reader, const char** chunk, size_t size);
+
+extern bool    reader_frame_pending(const struct reader* reader);
+
+extern int     reader_frame_fill(struct reader* reader);
+
+#endif // READER_H
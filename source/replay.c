@@ -0,0 +1,299 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#define _GNU_SOURCE
+
+#include "replay.h"
+
+/*
+ * The outbound link of the process, with the replay buffer
+ *
+ * The buffer holds the lines that the peer has not acknowledged:
+ * - [start, sent) | Sent lines, not yet acknowledged by the peer
+ * - [sent,  end)  | Lines that are not sent, because the link is down
+ *
+ * A line counts as acknowledged when the peer's TCP stack has acknowledged it,
+ * which is when it has left the kernel's send queue (SIOCOUTQ)
+ */
+static struct
+{
+  pthread_mutex_t lock;
+  int             sockfd;
+  bool            up;
+  char*           buffer;
+  size_t          size;
+  size_t          start;
+  size_t          sent;
+  size_t          end;
+  size_t          dropped;
+  size_t          replayed;
+} replay = { .lock = PTHREAD_MUTEX_INITIALIZER, .sockfd = -1 };
+
+/*
+ * Create the replay buffer for the connected socket
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to allocate replay buffer
+ */
+int replay_create(int sockfd, size_t size, bool debug)
+{
+  replay.buffer = pool_alloc(size);
+
+  if(!replay.buffer)
+  {
+    if(debug) error_print("Failed to allocate replay buffer");
+
+    return -1;
+  }
+
+  replay.sockfd   = sockfd;
+  replay.up       = true;
+  replay.size     = size;
+  replay.start    = 0;
+  replay.sent     = 0;
+  replay.end      = 0;
+  replay.dropped  = 0;
+  replay.replayed = 0;
+
+  return 0;
+}
+
+/*
+ * Free the replay buffer, reporting the lines that were never acknowledged
+ */
+void replay_free(bool debug)
+{
+  if(!replay.buffer) return;
+
+  if(debug)
+  {
+    info_print("Replay buffer: %ld bytes replayed, %ld bytes dropped, %ld bytes unacknowledged",
+      (long) replay.replayed, (long) replay.dropped, (long) (replay.end - replay.start));
+  }
+
+  pool_release(replay.buffer);
+
+  replay.buffer = NULL;
+}
+
+/*
+ * Forget the lines that the peer has acknowledged,
+ * keeping the partially acknowledged line for a replay
+ */
+static void replay_trim(void)
+{
+  int queued = 0;
+
+  if(ioctl(replay.sockfd, SIOCOUTQ, &queued) == -1) return;
+
+  size_t acked = replay.sent - replay.start;
+
+  acked = ((size_t) queued < acked) ? acked - queued : 0;
+
+  char* newline = memrchr(replay.buffer + replay.start, '\n', acked);
+
+  if(newline) replay.start = (newline - replay.buffer) + 1;
+
+  if(replay.start == replay.end)
+  {
+    replay.start = 0;
+    replay.sent  = 0;
+    replay.end   = 0;
+  }
+}
+
+/*
+ * Make room for length bytes at the end of the buffer,
+ * by moving the lines to the start of it, or by dropping the oldest lines
+ *
+ * RETURN (bool fits)
+ * - true  | There is room for the bytes
+ * - false | The bytes are larger than the buffer
+ */
+static bool replay_room_make(size_t length)
+{
+  if(length > replay.size) return false;
+
+  while(replay.end - replay.start + length > replay.size)
+  {
+    char* newline = memchr(replay.buffer + replay.start, '\n', replay.end - replay.start);
+
+    size_t drop = newline ? (newline - (replay.buffer + replay.start)) + 1 : replay.end - replay.start;
+
+    replay.dropped += drop;
+
+    replay.start += drop;
+
+    if(replay.sent < replay.start) replay.sent = replay.start;
+  }
+
+  if(replay.end + length > replay.size)
+  {
+    memmove(replay.buffer, replay.buffer + replay.start, replay.end - replay.start);
+
+    replay.sent -= replay.start;
+    replay.end  -= replay.start;
+    replay.start = 0;
+  }
+
+  return true;
+}
+
+/*
+ * Send the unsent bytes of the buffer over the link
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to send, the link is broken or the thread is interrupted
+ */
+static int replay_send(void)
+{
+  while(replay.sent < replay.end)
+  {
+    ssize_t status = send(replay.sockfd, replay.buffer + replay.sent, replay.end - replay.sent, MSG_NOSIGNAL);
+
+    if(status <= 0) return -1;
+
+    replay.sent += status;
+  }
+
+  replay_trim();
+
+  return 0;
+}
+
+/*
+ * Mark the link as broken and wake up the reading thread,
+ * which is the thread that reconnects
+ */
+static void replay_link_break(void)
+{
+  replay.up = false;
+
+  shutdown(replay.sockfd, SHUT_RDWR);
+}
+
+/*
+ * Write iovecs to the link, keeping the lines until the peer acknowledges them
+ *
+ * This is the flush function of a writer, instead of socket_write.
+ * While the link is down, the lines are only kept, so writing never stalls
+ *
+ * RETURN (ssize_t size)
+ * - >0 | The number of written characters
+ * -  0 | Nothing to write to
+ * - -1 | Interrupted
+ */
+ssize_t replay_write(int sockfd, const struct iovec* iovecs, int count)
+{
+  if(errno != 0) return -1;
+
+  if(!iovecs) return 0;
+
+  pthread_mutex_lock(&replay.lock);
+
+  ssize_t total = 0;
+
+  for(int index = 0; index < count; index++)
+  {
+    const char* bytes = iovecs[index].iov_base;
+
+    size_t length = iovecs[index].iov_len;
+
+    total += length;
+
+    if(replay_room_make(length))
+    {
+      memcpy(replay.buffer + replay.end, bytes, length);
+
+      replay.end += length;
+    }
+    else if(replay.up && replay_send() == 0 && send(replay.sockfd, bytes, length, MSG_NOSIGNAL) == (ssize_t) length)
+    {
+      // The bytes are larger than the buffer, and can't be replayed
+      continue;
+    }
+    else if(replay.up)
+    {
+      if(errno == EINTR) break;
+
+      replay_link_break();
+    }
+    else replay.dropped += length;
+  }
+
+  if(replay.up && errno != EINTR && replay_send() == -1 && errno != EINTR)
+  {
+    replay_link_break();
+  }
+
+  pthread_mutex_unlock(&replay.lock);
+
+  if(errno == EINTR) return -1;
+
+  // The broken link is handled by the reconnecting thread
+  errno = 0;
+
+  return total;
+}
+
+/*
+ * Stop sending over the link, because the connection was lost
+ */
+void replay_link_down(bool debug)
+{
+  pthread_mutex_lock(&replay.lock);
+
+  replay.up     = false;
+  replay.sockfd = -1;
+
+  // The unacknowledged lines will be sent again
+  replay.sent = replay.start;
+
+  if(debug) info_print("Link is down, keeping %ld bytes", (long) (replay.end - replay.start));
+
+  pthread_mutex_unlock(&replay.lock);
+}
+
+/*
+ * Replay the unacknowledged lines over the new connection,
+ * and continue sending over it
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to replay, the new connection is broken too
+ */
+int replay_link_up(int sockfd, bool debug)
+{
+  pthread_mutex_lock(&replay.lock);
+
+  replay.sockfd = sockfd;
+
+  replay.sent = replay.start;
+
+  size_t length = replay.end - replay.start;
+
+  if(debug) info_print("Link is up, replaying %ld bytes", (long) length);
+
+  int status = replay_send();
+
+  if(status == 0)
+  {
+    replay.up = true;
+
+    replay.replayed += length;
+  }
+  else
+  {
+    replay.sent   = replay.start;
+    replay.sockfd = -1;
+  }
+
+  pthread_mutex_unlock(&replay.lock);
+
+  return status;
+}
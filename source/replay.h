@@ -0,0 +1,35 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "debug.h"
+#include "pool.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <linux/sockios.h>
+
+#define REPLAY_SIZE 1048576
+
+extern int     replay_create(int sockfd, size_t size, bool debug);
+
+extern void    replay_free(bool debug);
+
+extern ssize_t replay_write(int sockfd, const struct iovec* iovecs, int count);
+
+extern void    replay_link_down(bool debug);
+
+extern int     replay_link_up(int sockfd, bool debug);
+
+#endif // REPLAY_H
@@ -0,0 +1,400 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#define _GNU_SOURCE
+
+#include "shm.h"
+
+/*
+ * Single producer, single consumer byte ring in shared memory
+ *
+ * The producer and the consumer positions are on separate cache lines.
+ * A side that has nothing to do spins for a while, and then sleeps
+ * on a futex, after telling the other side to wake it up
+ */
+struct shm_ring
+{
+  uint64_t head            __attribute__((aligned(64))); // Written by producer
+  uint32_t readers_waiting;
+  uint32_t closed;
+
+  uint64_t tail            __attribute__((aligned(64))); // Written by consumer
+  uint32_t writers_waiting;
+
+  char     data[SHM_RING_SIZE] __attribute__((aligned(64)));
+};
+
+/*
+ * The shared memory connection of the process, with one ring per direction
+ */
+static struct
+{
+  int              sockfd;
+  struct shm_ring* rings;
+  struct shm_ring* rx;
+  struct shm_ring* tx;
+  int              spins;
+} shm = { .sockfd = -1 };
+
+/*
+ * Send the memfd of the rings to the client, as ancillary data
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to send memfd
+ */
+static int shm_fd_send(int sockfd, int memfd)
+{
+  char byte = 0;
+
+  struct iovec iovec = { .iov_base = &byte, .iov_len = 1 };
+
+  char control[CMSG_SPACE(sizeof(int))] = { 0 };
+
+  struct msghdr message =
+  {
+    .msg_iov        = &iovec,
+    .msg_iovlen     = 1,
+    .msg_control    = control,
+    .msg_controllen = sizeof(control)
+  };
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type  = SCM_RIGHTS;
+  cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+
+  memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+
+  if(sendmsg(sockfd, &message, 0) != 1) return -1;
+
+  return 0;
+}
+
+/*
+ * Receive the memfd of the rings from the server
+ *
+ * RETURN (int memfd)
+ * - >=0 | Success
+ * -  -1 | Failed to receive memfd
+ */
+static int shm_fd_recv(int sockfd)
+{
+  char byte;
+
+  struct iovec iovec = { .iov_base = &byte, .iov_len = 1 };
+
+  char control[CMSG_SPACE(sizeof(int))] = { 0 };
+
+  struct msghdr message =
+  {
+    .msg_iov        = &iovec,
+    .msg_iovlen     = 1,
+    .msg_control    = control,
+    .msg_controllen = sizeof(control)
+  };
+
+  if(recvmsg(sockfd, &message, MSG_CMSG_CLOEXEC) != 1) return -1;
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+
+  if(!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) return -1;
+
+  int memfd;
+
+  memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+
+  return memfd;
+}
+
+/*
+ * Replace the socket connection with shared memory rings
+ *
+ * The server creates the rings and passes them to the client over the
+ * (unix) socket, which is kept open to notice if the peer goes away
+ *
+ * PARAMS
+ * - int sockfd  | Connected unix socket
+ * - bool server | This side created the server socket
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to create or receive the rings
+ */
+int shm_create(int sockfd, bool server, bool debug)
+{
+  size_t size = 2 * sizeof(struct shm_ring);
+
+  int memfd;
+
+  if(server)
+  {
+    if(debug) info_print("Creating shared memory rings");
+
+    memfd = memfd_create("procom", MFD_CLOEXEC);
+
+    if(memfd == -1)
+    {
+      if(debug) error_print("Failed to create memfd: %s", strerror(errno));
+
+      return -1;
+    }
+
+    // The memfd is zero filled, which is an empty and open ring
+    if(ftruncate(memfd, size) == -1 || shm_fd_send(sockfd, memfd) == -1)
+    {
+      if(debug) error_print("Failed to pass memfd: %s", strerror(errno));
+
+      close(memfd);
+
+      return -1;
+    }
+  }
+  else
+  {
+    if(debug) info_print("Receiving shared memory rings");
+
+    if((memfd = shm_fd_recv(sockfd)) == -1)
+    {
+      if(debug) error_print("Failed to receive memfd: %s", strerror(errno));
+
+      return -1;
+    }
+  }
+
+  void* rings = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, memfd, 0);
+
+  close(memfd);
+
+  if(rings == MAP_FAILED)
+  {
+    if(debug) error_print("Failed to map shared memory: %s", strerror(errno));
+
+    return -1;
+  }
+
+  shm.sockfd = sockfd;
+  shm.rings  = rings;
+
+  // Spinning only pays off if the peer runs on another cpu at the same time
+  shm.spins = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? SHM_SPINS : 0;
+
+  // The server produces to the first ring, the client to the second
+  shm.tx = shm.rings + (server ? 0 : 1);
+  shm.rx = shm.rings + (server ? 1 : 0);
+
+  if(debug) info_print("Created shared memory rings (%ld bytes)", (long) size);
+
+  return 0;
+}
+
+/*
+ * Wake up the other side, if it is sleeping on the futex
+ */
+static void shm_wake(uint32_t* waiting)
+{
+  // Only touch the flag when it is set, to keep its cache line shared
+  if(__atomic_load_n(waiting, __ATOMIC_SEQ_CST) == 1 && __atomic_exchange_n(waiting, 0, __ATOMIC_SEQ_CST) == 1)
+  {
+    syscall(SYS_futex, waiting, FUTEX_WAKE, 1, NULL, NULL, 0);
+  }
+}
+
+/*
+ * Tell the peer that nothing more will be written and unmap the rings
+ */
+void shm_close(bool debug)
+{
+  if(!shm.rings) return;
+
+  if(debug) info_print("Closing shared memory rings");
+
+  __atomic_store_n(&shm.tx->closed, 1, __ATOMIC_SEQ_CST);
+
+  shm_wake(&shm.tx->readers_waiting);
+
+  munmap(shm.rings, 2 * sizeof(struct shm_ring));
+
+  shm.rings = NULL;
+  shm.tx    = NULL;
+  shm.rx    = NULL;
+
+  if(debug) info_print("Closed shared memory rings");
+}
+
+static inline void shm_pause(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __asm__ volatile("pause");
+#elif defined(__aarch64__)
+  __asm__ volatile("yield");
+#endif
+}
+
+/*
+ * Check if the peer has gone away without closing its ring
+ */
+static bool shm_peer_gone(void)
+{
+  struct pollfd pollfd = { .fd = shm.sockfd, .events = POLLRDHUP };
+
+  return poll(&pollfd, 1, 0) == 1 && (pollfd.revents & (POLLRDHUP | POLLHUP | POLLERR));
+}
+
+/*
+ * Wait until ready returns true, first by spinning without syscalls
+ * (on multi-cpu hosts), and then by sleeping on the futex until the other side wakes us up
+ *
+ * RETURN (int status)
+ * -  0 | Success, ready
+ * - -1 | Interrupted, or the peer has gone away
+ */
+static int shm_wait(uint32_t* waiting, bool (*ready) (void))
+{
+  for(int spin = 0; spin < shm.spins; spin++)
+  {
+    if(ready()) return 0;
+
+    shm_pause();
+  }
+
+  struct timespec timeout = { .tv_sec = 0, .tv_nsec = SHM_TIMEOUT * 1000000L };
+
+  while(true)
+  {
+    __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+
+    // Check again, in case the other side was done before it saw the flag
+    if(ready())
+    {
+      __atomic_store_n(waiting, 0, __ATOMIC_SEQ_CST);
+
+      return 0;
+    }
+
+    if(syscall(SYS_futex, waiting, FUTEX_WAIT, 1, &timeout, NULL, 0) == -1)
+    {
+      if(errno == EINTR) return -1;
+
+      errno = 0; // EAGAIN (woken before sleeping) or ETIMEDOUT
+    }
+
+    if(ready()) return 0;
+
+    if(shm_peer_gone()) return -1;
+  }
+}
+
+/*
+ * There are bytes to read, or the peer has closed its ring
+ */
+static bool shm_rx_ready(void)
+{
+  return __atomic_load_n(&shm.rx->head, __ATOMIC_ACQUIRE) != shm.rx->tail ||
+         __atomic_load_n(&shm.rx->closed, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * There is room to write bytes
+ */
+static bool shm_tx_ready(void)
+{
+  return shm.tx->head - __atomic_load_n(&shm.tx->tail, __ATOMIC_ACQUIRE) < SHM_RING_SIZE;
+}
+
+/*
+ * Read a chunk of bytes from the shared memory ring
+ *
+ * This is the fill function of a reader, instead of socket_read
+ *
+ * RETURN (ssize_t size)
+ * - >0 | The number of read characters
+ * -  0 | Nothing to read, end of file
+ * - -1 | Failed to read, or interrupted
+ */
+ssize_t shm_read(int sockfd, char* buffer, size_t size)
+{
+  if(errno != 0) return -1;
+
+  if(!buffer || !shm.rx) return 0;
+
+  if(shm_wait(&shm.rx->readers_waiting, shm_rx_ready) == -1) return -1;
+
+  uint64_t tail = shm.rx->tail;
+
+  uint64_t head = __atomic_load_n(&shm.rx->head, __ATOMIC_ACQUIRE);
+
+  if(head == tail) return 0; // End Of File
+
+  size_t length = head - tail;
+
+  if(length > size) length = size;
+
+  size_t offset = tail & (SHM_RING_SIZE - 1);
+
+  size_t first = (length < SHM_RING_SIZE - offset) ? length : SHM_RING_SIZE - offset;
+
+  memcpy(buffer, shm.rx->data + offset, first);
+
+  memcpy(buffer + first, shm.rx->data, length - first);
+
+  __atomic_store_n(&shm.rx->tail, tail + length, __ATOMIC_SEQ_CST);
+
+  shm_wake(&shm.rx->writers_waiting);
+
+  return length;
+}
+
+/*
+ * Write iovecs to the shared memory ring, as many bytes as there is room for
+ *
+ * This is the flush function of a writer, instead of socket_write
+ *
+ * RETURN (ssize_t size)
+ * - >0 | The number of written characters
+ * -  0 | Nothing to write to
+ * - -1 | Failed to write, or interrupted
+ */
+ssize_t shm_write(int sockfd, const struct iovec* iovecs, int count)
+{
+  if(errno != 0) return -1;
+
+  if(!iovecs || !shm.tx) return 0;
+
+  if(shm_wait(&shm.tx->writers_waiting, shm_tx_ready) == -1) return -1;
+
+  uint64_t head = shm.tx->head;
+
+  size_t room = SHM_RING_SIZE - (head - __atomic_load_n(&shm.tx->tail, __ATOMIC_ACQUIRE));
+
+  size_t written = 0;
+
+  for(int index = 0; index < count && written < room; index++)
+  {
+    const char* bytes = iovecs[index].iov_base;
+
+    size_t length = iovecs[index].iov_len;
+
+    if(length > room - written) length = room - written;
+
+    size_t offset = (head + written) & (SHM_RING_SIZE - 1);
+
+    size_t first = (length < SHM_RING_SIZE - offset) ? length : SHM_RING_SIZE - offset;
+
+    memcpy(shm.tx->data + offset, bytes, first);
+
+    memcpy(shm.tx->data, bytes + first, length - first);
+
+    written += length;
+  }
+
+  __atomic_store_n(&shm.tx->head, head + written, __ATOMIC_SEQ_CST);
+
+  shm_wake(&shm.tx->readers_waiting);
+
+  return written;
+}
@@ -0,0 +1,37 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef SHM_H
+#define SHM_H
+
+#include "debug.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/futex.h>
+
+#define SHM_RING_SIZE 1048576 // Has to be a power of two
+#define SHM_SPINS     16384
+#define SHM_TIMEOUT   100     // Milliseconds between checks of the peer
+
+extern int     shm_create(int sockfd, bool server, bool debug);
+
+extern void    shm_close(bool debug);
+
+extern ssize_t shm_read(int sockfd, char* buffer, size_t size);
+
+extern ssize_t shm_write(int sockfd, const struct iovec* iovecs, int count);
+
+#endif // SHM_H
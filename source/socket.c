@@ -1,38 +1,100 @@
 /*
  * Written by Hampus Fridholm
  *
- * Last updated: 2024-09-08
+ * Last updated: 2026-10-15
  */
 
 #include "socket.h"
 
 /*
- * Create sockaddr from address and port
+ * Create the sockaddr of a unix socket from its path
+ *
+ * A path starting with '@' is a name in the abstract namespace,
+ * which doesn't exist in the filesystem
+ *
+ * RETURN (socklen_t addrlen)
+ * - >0 | Success! The length of the sockaddr
+ * -  0 | Invalid path
+ */
+static socklen_t unix_sockaddr_create(struct sockaddr_un* addr, const char* path, bool debug)
+{
+  memset(addr, 0, sizeof(struct sockaddr_un));
+
+  size_t length = strlen(path);
+
+  if(length == 0 || length >= sizeof(addr->sun_path))
+  {
+    if(debug) error_print("Invalid unix socket path (%s)", path);
+
+    return 0;
+  }
+
+  addr->sun_family = AF_UNIX;
+
+  memcpy(addr->sun_path, path, length);
+
+  // The abstract namespace is marked by a leading NUL byte
+  if(path[0] == '@') addr->sun_path[0] = '\0';
+
+  return offsetof(struct sockaddr_un, sun_path) + length + (path[0] == '@' ? 0 : 1);
+}
+
+/*
+ * Resolve address and port into IPv4 and IPv6 candidates, using getaddrinfo
+ *
+ * An empty address is the wildcard address for servers,
+ * and the loopback address for clients
  *
  * PARAMS
- * - bool debug | Print debug messages
+ * - bool passive | The candidates are addresses to bind to
  *
- * RETURN (struct sockaddr_in addr)
+ * RETURN (struct addrinfo* candidates)
+ * - !NULL | Success! Free with freeaddrinfo
+ * -  NULL | Failed to resolve address
  */
-static struct sockaddr_in sockaddr_create(int sockfd, const char* address, int port, bool debug)
+static struct addrinfo* address_resolve(const char* address, int port, bool passive, bool debug)
 {
-  struct sockaddr_in addr;
+  struct addrinfo hints =
+  {
+    .ai_family   = AF_UNSPEC,
+    .ai_socktype = SOCK_STREAM,
+    .ai_flags    = AI_ADDRCONFIG | (passive ? AI_PASSIVE : 0)
+  };
 
-  if(strlen(address) == 0)
+  char service[16];
+
+  snprintf(service, sizeof(service), "%d", port);
+
+  struct addrinfo* candidates = NULL;
+
+  int status = getaddrinfo((strlen(address) > 0) ? address : NULL, service, &hints, &candidates);
+
+  if(status != 0)
   {
-    socklen_t addrlen = sizeof(addr);
+    if(debug) error_print("Failed to resolve address (%s:%d): %s", address, port, gai_strerror(status));
 
-    if(getsockname(sockfd, (struct sockaddr*) &addr, &addrlen) == -1)
-    {
-      if(debug) error_print("Failed to get sock name: %s", strerror(errno));
-    }
+    return NULL;
   }
-  else addr.sin_addr.s_addr = inet_addr(address);
 
-  addr.sin_family = AF_INET;
-  addr.sin_port = htons(port);
+  return candidates;
+}
 
-  return addr;
+/*
+ * Format the numeric host and port of a sockaddr, for debug messages
+ */
+static void sockaddr_name(char* name, size_t size, const struct sockaddr* addr, socklen_t addrlen)
+{
+  char host[INET6_ADDRSTRLEN], service[16];
+
+  if(getnameinfo(addr, addrlen, host, sizeof(host), service, sizeof(service), NI_NUMERICHOST | NI_NUMERICSERV) != 0)
+  {
+    snprintf(name, size, "unknown");
+  }
+  else if(addr->sa_family == AF_INET6)
+  {
+    snprintf(name, size, "[%s]:%s", host, service);
+  }
+  else snprintf(name, size, "%s:%s", host, service);
 }
 
 /*
@@ -42,20 +104,18 @@ static struct sockaddr_in sockaddr_create(int sockfd, const char* address, int p
  * -  0 | Success
  * - -1 | Failed to bind socket
  */
-static int socket_bind(int sockfd, const char* address, int port, bool debug)
+static int socket_bind(int sockfd, const struct sockaddr* addr, socklen_t addrlen, const char* name, bool debug)
 {
-  struct sockaddr_in addr = sockaddr_create(sockfd, address, port, debug);
+  if(debug) info_print("Binding socket (%s)", name);
 
-  if(debug) info_print("Binding socket (%s:%d)", address, port);
-
-  if(bind(sockfd, (struct sockaddr*) &addr, sizeof(addr)) == -1)
+  if(bind(sockfd, addr, addrlen) == -1)
   {
-    if(debug) error_print("Failed to bind socket (%s:%d): %s", address, port, strerror(errno));
+    if(debug) error_print("Failed to bind socket (%s): %s", name, strerror(errno));
 
     return -1;
   }
   
-  if(debug) info_print("Binded socket (%s:%d)", address, port);
+  if(debug) info_print("Binded socket (%s)", name);
 
   return 0;
 }
@@ -86,15 +146,19 @@ static int socket_listen(int sockfd, int backlog, bool debug)
 /*
  * socket, with debug messages
  *
+ * PARAMS
+ * - int domain | AF_INET, AF_INET6 or AF_UNIX
+ * - int flags  | Extra socket type flags, like SOCK_NONBLOCK
+ *
  * RETURN (int sockfd)
  * - >=0 | Success
  * -  -1 | Failed to create socket
  */
-static int socket_create(bool debug)
+static int socket_create(int domain, int flags, bool debug)
 {
   if(debug) info_print("Creating socket");
 
-  int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  int sockfd = socket(domain, SOCK_STREAM | flags, 0);
 
   if(sockfd == -1)
   {
@@ -109,19 +173,35 @@ static int socket_create(bool debug)
 }
 
 /*
- * Create a server socket, bind it and start listening for clients
+ * Create a server socket, bind it to addr and start listening for clients
  *
  * RETURN (int servfd)
  * - >=0 | Success
  * -  -1 | Failed to create server socket
  */
-static int server_socket_create(const char* address, int port, bool debug)
+static int sockaddr_server_create(const struct sockaddr* addr, socklen_t addrlen, const char* name, int backlog, bool debug)
 {
-  int servfd = socket_create(debug);
+  int servfd = socket_create(addr->sa_family, 0, debug);
 
   if(servfd == -1) return -1;
 
-  if(socket_bind(servfd, address, port, debug) == -1 || socket_listen(servfd, 1, debug) == -1)
+  int flag = 1;
+
+  // Allow a new server to bind the port while old connections are in TIME_WAIT
+  if(addr->sa_family != AF_UNIX && setsockopt(servfd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag)) == -1)
+  {
+    if(debug) error_print("Failed to reuse address: %s", strerror(errno));
+  }
+
+  flag = 0;
+
+  // An IPv6 wildcard server also accepts IPv4 clients (dual-stack)
+  if(addr->sa_family == AF_INET6 && setsockopt(servfd, IPPROTO_IPV6, IPV6_V6ONLY, &flag, sizeof(flag)) == -1)
+  {
+    if(debug) error_print("Failed to enable dual-stack: %s", strerror(errno));
+  }
+
+  if(socket_bind(servfd, addr, addrlen, name, debug) == -1 || socket_listen(servfd, backlog, debug) == -1)
   {
     socket_close(&servfd, debug);
 
@@ -131,6 +211,49 @@ static int server_socket_create(const char* address, int port, bool debug)
   return servfd;
 }
 
+/*
+ * Create a server socket, bound to the first candidate of address that works
+ *
+ * PARAMS
+ * - int domain | AF_UNIX for a unix socket at path address, else AF_UNSPEC
+ *
+ * RETURN (int servfd)
+ * - >=0 | Success
+ * -  -1 | Failed to create server socket
+ */
+static int server_socket_create(int domain, const char* address, int port, int backlog, bool debug)
+{
+  if(domain == AF_UNIX)
+  {
+    struct sockaddr_un addr;
+
+    socklen_t addrlen = unix_sockaddr_create(&addr, address, debug);
+
+    if(addrlen == 0) return -1;
+
+    return sockaddr_server_create((struct sockaddr*) &addr, addrlen, address, backlog, debug);
+  }
+
+  struct addrinfo* candidates = address_resolve(address, port, true, debug);
+
+  if(!candidates) return -1;
+
+  int servfd = -1;
+
+  for(struct addrinfo* candidate = candidates; candidate && servfd == -1; candidate = candidate->ai_next)
+  {
+    char name[128];
+
+    sockaddr_name(name, sizeof(name), candidate->ai_addr, candidate->ai_addrlen);
+
+    servfd = sockaddr_server_create(candidate->ai_addr, candidate->ai_addrlen, name, backlog, debug);
+  }
+
+  freeaddrinfo(candidates);
+
+  return servfd;
+}
+
 /*
  * connect, with debug messages
  *
@@ -138,63 +261,254 @@ static int server_socket_create(const char* address, int port, bool debug)
  * -  0 | Success
  * - -1 | Failed to connect to server socket
  */
-static int socket_connect(int sockfd, const char* address, int port, bool debug)
+static int socket_connect(int sockfd, const struct sockaddr* addr, socklen_t addrlen, const char* name, bool debug)
 {
-  struct sockaddr_in addr = sockaddr_create(sockfd, address, port, debug);
-
-  if(debug) info_print("Connecting socket (%s:%d)", address, port);
+  if(debug) info_print("Connecting socket (%s)", name);
 
-  if(connect(sockfd, (struct sockaddr*) &addr, sizeof(addr)) == -1)
+  if(connect(sockfd, addr, addrlen) == -1)
   {
-    if(debug) error_print("Failed to connect socket (%s:%d): %s", address, port, strerror(errno));
+    if(debug) error_print("Failed to connect socket (%s): %s", name, strerror(errno));
 
     return -1;
   }
 
-  if(debug) info_print("Connected socket (%s:%d)", address, port);
+  if(debug) info_print("Connected socket (%s)", name);
 
   return 0;
 }
 
 /*
- * Create a client socket and connect it to the server socket
+ * Order the candidates so that the address families alternate,
+ * starting with the family of the first (preferred) candidate
+ *
+ * RETURN (int count)
+ * - The number of ordered candidates
+ */
+static int candidates_interleave(struct addrinfo** ordered, struct addrinfo* candidates)
+{
+  struct addrinfo* first[SOCKET_CANDIDATES];
+  struct addrinfo* other[SOCKET_CANDIDATES];
+
+  int first_count = 0, other_count = 0;
+
+  for(struct addrinfo* candidate = candidates; candidate; candidate = candidate->ai_next)
+  {
+    if(candidate->ai_family == candidates->ai_family)
+    {
+      if(first_count < SOCKET_CANDIDATES) first[first_count++] = candidate;
+    }
+    else if(other_count < SOCKET_CANDIDATES) other[other_count++] = candidate;
+  }
+
+  int count = 0;
+
+  for(int index = 0; count < SOCKET_CANDIDATES && (index < first_count || index < other_count); index++)
+  {
+    if(index < first_count) ordered[count++] = first[index];
+
+    if(index < other_count && count < SOCKET_CANDIDATES) ordered[count++] = other[index];
+  }
+
+  return count;
+}
+
+/*
+ * Connect to the first candidate that accepts the connection (happy eyeballs)
+ *
+ * The candidates are tried with non-blocking connects, starting a new attempt
+ * every SOCKET_CONNECT_DELAY milliseconds, or as soon as an attempt fails,
+ * while the earlier attempts are still running
  *
  * RETURN (int sockfd)
- * - >=0 | Success
- * -  -1 | Failed to create server socket
+ * - >=0 | Success, a blocking socket
+ * -  -1 | Failed to connect to any candidate
  */
-static int client_socket_create(const char* address, int port, bool debug)
+static int candidates_connect(struct addrinfo* candidates, bool debug)
 {
-  int sockfd = socket_create(debug);
+  struct addrinfo* ordered[SOCKET_CANDIDATES];
+
+  int count = candidates_interleave(ordered, candidates);
+
+  struct pollfd pollfds[SOCKET_CANDIDATES];
+
+  int started = 0, running = 0, sockfd = -1;
+
+  int error = ECONNREFUSED;
+
+  while(sockfd == -1 && (started < count || running > 0))
+  {
+    // 1. Start an attempt to connect to the next candidate
+    if(started < count)
+    {
+      struct addrinfo* candidate = ordered[started];
+
+      char name[128];
+
+      sockaddr_name(name, sizeof(name), candidate->ai_addr, candidate->ai_addrlen);
 
-  if(sockfd == -1) return -1;
+      if(debug) info_print("Connecting socket (%s)", name);
 
-  if(socket_connect(sockfd, address, port, debug) == -1)
+      int attempt = socket_create(candidate->ai_family, SOCK_NONBLOCK, debug);
+
+      pollfds[started] = (struct pollfd) { .fd = -1, .events = POLLOUT };
+
+      if(attempt != -1 && connect(attempt, candidate->ai_addr, candidate->ai_addrlen) == 0)
+      {
+        sockfd = attempt;
+      }
+      else if(attempt != -1 && errno == EINPROGRESS)
+      {
+        pollfds[started].fd = attempt;
+
+        running++;
+      }
+      else
+      {
+        error = errno;
+
+        if(debug) error_print("Failed to connect socket (%s): %s", name, strerror(errno));
+
+        socket_close(&attempt, debug);
+      }
+
+      started++;
+
+      // Without running attempts, the next candidate is started right away
+      if(sockfd != -1 || running == 0) continue;
+    }
+
+    // 2. Wait for a running attempt to finish, or for the time to start the next one
+    int status = poll(pollfds, started, (started < count) ? SOCKET_CONNECT_DELAY : -1);
+
+    if(status == -1)
+    {
+      error = errno;
+
+      break;
+    }
+
+    for(int index = 0; index < started && sockfd == -1 && status > 0; index++)
+    {
+      if(pollfds[index].fd == -1 || pollfds[index].revents == 0) continue;
+
+      int attempt = pollfds[index].fd;
+
+      int result = 0;
+
+      socklen_t length = sizeof(result);
+
+      if(getsockopt(attempt, SOL_SOCKET, SO_ERROR, &result, &length) == -1) result = errno;
+
+      pollfds[index].fd = -1;
+
+      running--;
+
+      if(result == 0)
+      {
+        sockfd = attempt;
+
+        continue;
+      }
+
+      error = result;
+
+      if(debug) error_print("Failed to connect socket (%d): %s", attempt, strerror(result));
+
+      socket_close(&attempt, debug);
+    }
+  }
+
+  // 3. Abandon the attempts that lost the race
+  for(int index = 0; index < started; index++)
+  {
+    if(pollfds[index].fd != -1) socket_close(&pollfds[index].fd, debug);
+  }
+
+  if(sockfd == -1)
+  {
+    errno = error;
+
+    return -1;
+  }
+
+  // The winning socket is used as a blocking socket
+  if(fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL) & ~O_NONBLOCK) == -1)
   {
     socket_close(&sockfd, debug);
 
     return -1;
   }
 
+  if(debug) info_print("Connected socket (%d)", sockfd);
+
+  return sockfd;
+}
+
+/*
+ * Create a client socket and connect it to the server socket
+ *
+ * PARAMS
+ * - int domain | AF_UNIX for a unix socket at path address, else AF_UNSPEC
+ *
+ * RETURN (int sockfd)
+ * - >=0 | Success
+ * -  -1 | Failed to create server socket
+ */
+static int client_socket_create(int domain, const char* address, int port, bool debug)
+{
+  if(domain == AF_UNIX)
+  {
+    struct sockaddr_un addr;
+
+    socklen_t addrlen = unix_sockaddr_create(&addr, address, debug);
+
+    if(addrlen == 0) return -1;
+
+    int sockfd = socket_create(AF_UNIX, 0, debug);
+
+    if(sockfd == -1) return -1;
+
+    if(socket_connect(sockfd, (struct sockaddr*) &addr, addrlen, address, debug) == -1)
+    {
+      int error = errno;
+
+      socket_close(&sockfd, debug);
+
+      errno = error;
+
+      return -1;
+    }
+
+    return sockfd;
+  }
+
+  struct addrinfo* candidates = address_resolve(address, port, false, debug);
+
+  if(!candidates) return -1;
+
+  int sockfd = candidates_connect(candidates, debug);
+
+  freeaddrinfo(candidates);
+
   return sockfd;
 }
 
 /*
- * accept, but with address and port, and with debug messages
+ * accept, with debug messages
  *
  * RETURN (int sockfd)
  * - >=0 | Success
  * -  -1 | Failed to accept socket
  */
-static int socket_accept(int servfd, const char* address, int port, bool debug)
+int socket_accept(int servfd, bool debug)
 {
-  struct sockaddr_in sockaddr = sockaddr_create(servfd, address, port, debug);
+  struct sockaddr_storage sockaddr;
 
-  int addrlen = sizeof(sockaddr);
+  socklen_t addrlen = sizeof(sockaddr);
 
   if(debug) info_print("Accepting socket");
 
-  int sockfd = accept(servfd, (struct sockaddr*) &sockaddr, (socklen_t*) &addrlen);
+  int sockfd = accept(servfd, (struct sockaddr*) &sockaddr, &addrlen);
 
   if(sockfd == -1)
   {
@@ -209,28 +523,60 @@ static int socket_accept(int servfd, const char* address, int port, bool debug)
 }
 
 /*
- * RETURN (int status)
- * - 0 | Success!
- * - 1 | Failed to create server socket
- * - 2 | Failed to create client socket
+ * Connect to a server, or create a server if no server was running,
+ * without accepting a client
  *
- * This function is designed to clean up after it,
- * in case that it failed
+ * A stale unix socket file, left by a server that is no longer running,
+ * is removed before the new server is created, but any other file is left alone
+ *
+ * RETURN (same as client_or_server_socket_open)
  */
-int client_or_server_socket_create(int* sockfd, int* servfd, const char* address, int port, bool debug)
+static int domain_socket_open(int* sockfd, int* servfd, int domain, const char* address, int port, int backlog, bool debug)
 {
   // 1. Try to connect to a server using address and port
-  *sockfd = client_socket_create(address, port, debug);
+  *sockfd = client_socket_create(domain, address, port, debug);
 
   if(*sockfd != -1) return 0;
 
+  // Connecting to a file that is not a socket is refused as well, and that file is not ours to remove
+  if(domain == AF_UNIX && address[0] != '@' && errno == ECONNREFUSED)
+  {
+    struct stat stat;
+
+    if(lstat(address, &stat) == -1 || !S_ISSOCK(stat.st_mode))
+    {
+      if(debug) error_print("Unix socket path (%s) is taken by a file that is not a socket", address);
+
+      return 1;
+    }
+
+    if(debug) info_print("Removing stale unix socket (%s)", address);
+
+    unlink(address);
+  }
+
   // 2. If no server was running, create a new server
-  *servfd = server_socket_create(address, port, debug);
+  *servfd = server_socket_create(domain, address, port, backlog, debug);
 
   if(*servfd == -1) return 1;
 
-  // 3. Accept client connecting to server
-  *sockfd = socket_accept(*servfd, address, port, debug);
+  return 0;
+}
+
+/*
+ * Connect to a server and accept a client, if a new server was created
+ *
+ * RETURN (same as client_or_server_socket_create)
+ */
+static int domain_socket_create(int* sockfd, int* servfd, int domain, const char* address, int port, bool debug)
+{
+  // 1. Connect to a server, or create a new server
+  if(domain_socket_open(sockfd, servfd, domain, address, port, 1, debug) != 0) return 1;
+
+  if(*sockfd != -1) return 0;
+
+  // 2. Accept client connecting to server
+  *sockfd = socket_accept(*servfd, debug);
 
   if(*sockfd != -1) return 0;
 
@@ -239,6 +585,102 @@ int client_or_server_socket_create(int* sockfd, int* servfd, const char* address
   return 2;
 }
 
+/*
+ * Connect to a server, or create a server if no server was running,
+ * without accepting a client
+ *
+ * On success, either sockfd (client) or servfd (server) is set
+ *
+ * PARAMS
+ * - int backlog | The number of clients that can wait to be accepted
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to create server socket
+ */
+int client_or_server_socket_open(int* sockfd, int* servfd, const char* address, int port, int backlog, bool debug)
+{
+  return domain_socket_open(sockfd, servfd, AF_UNSPEC, address, port, backlog, debug);
+}
+
+/*
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to create server socket
+ * - 2 | Failed to create client socket
+ *
+ * This function is designed to clean up after it,
+ * in case that it failed
+ */
+int client_or_server_socket_create(int* sockfd, int* servfd, const char* address, int port, bool debug)
+{
+  return domain_socket_create(sockfd, servfd, AF_UNSPEC, address, port, debug);
+}
+
+/*
+ * Same as client_or_server_socket_open, but with a unix socket,
+ * for peers on the same host
+ *
+ * PARAMS
+ * - const char* path | Path of the socket file, or @name in the abstract namespace
+ *
+ * RETURN (same as client_or_server_socket_open)
+ */
+int client_or_server_unix_socket_open(int* sockfd, int* servfd, const char* path, int backlog, bool debug)
+{
+  return domain_socket_open(sockfd, servfd, AF_UNIX, path, 0, backlog, debug);
+}
+
+/*
+ * Same as client_or_server_socket_create, but with a unix socket,
+ * for peers on the same host
+ *
+ * RETURN (same as client_or_server_socket_create)
+ */
+int client_or_server_unix_socket_create(int* sockfd, int* servfd, const char* path, bool debug)
+{
+  return domain_socket_create(sockfd, servfd, AF_UNIX, path, 0, debug);
+}
+
+/*
+ * Connect to a server, without becoming a server if none is running,
+ * for example to reconnect after the connection was lost
+ *
+ * RETURN (int sockfd)
+ * - >=0 | Success
+ * -  -1 | Failed to connect to server
+ */
+int client_socket_connect(const char* address, int port, bool debug)
+{
+  return client_socket_create(AF_UNSPEC, address, port, debug);
+}
+
+/*
+ * Same as client_socket_connect, but with a unix socket
+ *
+ * RETURN (same as client_socket_connect)
+ */
+int client_unix_socket_connect(const char* path, bool debug)
+{
+  return client_socket_create(AF_UNIX, path, 0, debug);
+}
+
+/*
+ * Remove the socket file of a unix server socket
+ *
+ * Note: Names in the abstract namespace are removed with the socket
+ */
+void unix_socket_unlink(const char* path, bool debug)
+{
+  if(!path || path[0] == '@') return;
+
+  if(unlink(path) == -1)
+  {
+    if(debug) error_print("Failed to remove unix socket (%s): %s", path, strerror(errno));
+  }
+  else if(debug) info_print("Removed unix socket (%s)", path);
+}
+
 /*
  * close, but with pointer to file descriptor, and with debug messages
  *
@@ -269,7 +711,9 @@ int socket_close(int* sockfd, bool debug)
 }
 
 /*
- * Read a single line to a buffer from a socket connection
+ * Read a chunk of bytes from a socket connection, using a single recv call
+ *
+ * This is the fill function of a reader, which frames the chunks into lines
  *
  * RETURN (ssize_t size)
  * - >0 | The number of read characters
@@ -282,52 +726,38 @@ ssize_t socket_read(int sockfd, char* buffer, size_t size)
 
   if(!buffer) return 0;
 
-  char symbol = '\0';
-  ssize_t index;
-
-  for(index = 0; index < size && symbol != '\n'; index++)
-  {
-    ssize_t status = recv(sockfd, &symbol, 1, 0);
+  ssize_t status = recv(sockfd, buffer, size, 0);
 
-    if(status == -1 || errno != 0) return -1; // ERROR
+  if(status == -1 || errno != 0) return -1; // ERROR
 
-    buffer[index] = symbol;
-
-    if(status == 0) return 0; // End Of File
-  }
-
-  return index;
+  return status;
 }
 
 /*
- * Write a single line from a buffer to a socket connection
+ * Write iovecs to a socket connection, using a single sendmsg call
+ *
+ * This is the flush function of a writer, which batches lines
  *
  * RETURN (ssize_t size)
  * - >0 | The number of written characters
  * -  0 | Nothing to write to, end of file
  * - -1 | Failed to write to socket
  */
-ssize_t socket_write(int sockfd, const char* buffer, size_t size)
+ssize_t socket_write(int sockfd, const struct iovec* iovecs, int count)
 {
   if(errno != 0) return -1;
 
-  if(!buffer) return 0;
-
-  ssize_t index;
-  char symbol = '\0';
+  if(!iovecs) return 0;
 
-  for(index = 0; index < size && symbol != '\n'; index++)
+  struct msghdr message =
   {
-    symbol = buffer[index];
+    .msg_iov    = (struct iovec*) iovecs,
+    .msg_iovlen = count
+  };
 
-    ssize_t status = send(sockfd, &symbol, 1, 0);
+  ssize_t status = sendmsg(sockfd, &message, 0);
 
-    if(status == -1 || errno != 0) return -1; // ERROR
-    
-    if(status == 0) return 0; // End Of File
-
-    if(symbol == '\0') break;
-  }
+  if(status == -1 || errno != 0) return -1; // ERROR
 
-  return index;
+  return status;
 }
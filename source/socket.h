@@ -1,7 +1,7 @@
 /*
  * Written by Hampus Fridholm
  *
- * Last updated: 2024-09-08
+ * Last updated: 2026-10-15
  */
 
 #ifndef SOCKET_H
@@ -11,20 +11,45 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/stat.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
 
+#include <stdio.h>
+#include <stddef.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
 #include <stdbool.h>
 
+#define SOCKET_CANDIDATES    8   // Resolved addresses to try connecting to
+#define SOCKET_CONNECT_DELAY 250 // Milliseconds before racing the next address
+
 extern int client_or_server_socket_create(int* sockfd, int* servfd, const char* address, int port, bool debug);
 
+extern int client_or_server_socket_open(int* sockfd, int* servfd, const char* address, int port, int backlog, bool debug);
+
+extern int client_or_server_unix_socket_create(int* sockfd, int* servfd, const char* path, bool debug);
+
+extern int client_or_server_unix_socket_open(int* sockfd, int* servfd, const char* path, int backlog, bool debug);
+
+extern int client_socket_connect(const char* address, int port, bool debug);
+
+extern int client_unix_socket_connect(const char* path, bool debug);
+
+extern void unix_socket_unlink(const char* path, bool debug);
+
+extern int socket_accept(int servfd, bool debug);
+
 extern int socket_close(int* sockfd, bool debug);
 
 
-extern ssize_t socket_write(int sockfd, const char* buffer, size_t size);
+extern ssize_t socket_write(int sockfd, const struct iovec* iovecs, int count);
 
 extern ssize_t socket_read(int sockfd, char* buffer, size_t size);
 
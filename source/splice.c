@@ -0,0 +1,195 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#define _GNU_SOURCE
+
+#include "splice.h"
+
+/*
+ * Check if file descriptor is a pipe (or fifo)
+ */
+static bool fd_is_pipe(int fd)
+{
+  struct stat status;
+
+  if(fstat(fd, &status) == -1) return false;
+
+  return S_ISFIFO(status.st_mode);
+}
+
+/*
+ * Copy the bytes left in the internal pipe to the output,
+ * if the output turned out not to be spliceable
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to copy bytes
+ */
+static int splice_pipe_drain(int pipe_fd, int out_fd, size_t size)
+{
+  char buffer[1024];
+
+  while(size > 0)
+  {
+    ssize_t read_size = read(pipe_fd, buffer, (size < sizeof(buffer)) ? size : sizeof(buffer));
+
+    if(read_size <= 0) return -1;
+
+    for(ssize_t index = 0; index < read_size;)
+    {
+      ssize_t write_size = write(out_fd, buffer + index, read_size - index);
+
+      if(write_size <= 0) return -1;
+
+      index += write_size;
+    }
+
+    size -= read_size;
+  }
+
+  return 0;
+}
+
+/*
+ * Move bytes directly from input to output, when one of them is a pipe
+ *
+ * RETURN (same as splice_relay)
+ */
+static int splice_direct_relay(int in_fd, int out_fd, size_t* moved, size_t* syscalls)
+{
+  ssize_t status;
+
+  while((status = splice(in_fd, NULL, out_fd, NULL, SPLICE_SIZE, SPLICE_F_MOVE)) > 0)
+  {
+    (*syscalls)++;
+
+    *moved += status;
+  }
+
+  (*syscalls)++;
+
+  if(status == -1)
+  {
+    // The endpoints can't be spliced, nothing has been moved
+    if(errno == EINVAL && *moved == 0)
+    {
+      errno = 0;
+
+      return 1;
+    }
+
+    return 3;
+  }
+
+  return 0;
+}
+
+/*
+ * Move bytes from input to output through an internal pipe,
+ * when neither of them is a pipe
+ *
+ * RETURN (same as splice_relay)
+ */
+static int splice_pipe_relay(int in_fd, int out_fd, size_t* moved, size_t* syscalls)
+{
+  int pipefd[2];
+
+  if(pipe(pipefd) == -1) return 2;
+
+  int status = 0;
+
+  ssize_t in_size;
+
+  while(((*syscalls)++, in_size = splice(in_fd, NULL, pipefd[1], NULL, SPLICE_SIZE, SPLICE_F_MOVE)) > 0)
+  {
+    ssize_t out_size = 0;
+
+    for(ssize_t index = 0; index < in_size; index += out_size)
+    {
+      out_size = splice(pipefd[0], NULL, out_fd, NULL, in_size - index, SPLICE_F_MOVE);
+
+      (*syscalls)++;
+
+      if(out_size > 0) continue;
+
+      // The output can't be spliced, copy the bytes in the pipe and fall back
+      if(out_size == -1 && errno == EINVAL && *moved == 0)
+      {
+        errno = 0;
+
+        status = (splice_pipe_drain(pipefd[0], out_fd, in_size - index) == 0) ? 1 : 3;
+      }
+      else status = 3;
+
+      break;
+    }
+
+    if(status != 0) break;
+
+    *moved += in_size;
+  }
+
+  if(in_size == -1)
+  {
+    // The input can't be spliced, nothing has been moved
+    if(errno == EINVAL && *moved == 0)
+    {
+      errno = 0;
+
+      status = 1;
+    }
+    else status = 3;
+  }
+
+  close(pipefd[0]);
+
+  close(pipefd[1]);
+
+  return status;
+}
+
+/*
+ * Relay bytes from input to output with splice, without copying them into user space
+ *
+ * If either input or output is a pipe (fifo), the bytes are spliced directly,
+ * else they are spliced through an internal pipe
+ *
+ * RETURN (int status)
+ * - 0 | Success, end of file
+ * - 1 | Endpoints can't be spliced, fall back to buffered relay
+ * - 2 | Failed to create internal pipe
+ * - 3 | Failed to splice
+ */
+int splice_relay(int in_fd, int out_fd, bool debug)
+{
+  size_t moved = 0, syscalls = 0;
+
+  int status;
+
+  if(fd_is_pipe(in_fd) || fd_is_pipe(out_fd))
+  {
+    status = splice_direct_relay(in_fd, out_fd, &moved, &syscalls);
+  }
+  else status = splice_pipe_relay(in_fd, out_fd, &moved, &syscalls);
+
+  if(status == 1)
+  {
+    if(debug) info_print("Can't splice (%d) => (%d), falling back to buffered relay", in_fd, out_fd);
+
+    return 1;
+  }
+
+  if(status == 2)
+  {
+    if(debug) error_print("Failed to create splice pipe: %s", strerror(errno));
+
+    return 2;
+  }
+
+  if(debug) info_print("Spliced %ld bytes (%d) => (%d) with %ld syscalls", (long) moved, in_fd, out_fd, (long) syscalls);
+
+  return status;
+}
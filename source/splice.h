@@ -0,0 +1,23 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef SPLICE_H
+#define SPLICE_H
+
+#include "debug.h"
+
+#include <stdbool.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define SPLICE_SIZE 65536
+
+extern int splice_relay(int in_fd, int out_fd, bool debug);
+
+#endif // SPLICE_H
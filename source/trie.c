@@ -0,0 +1,155 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#include "trie.h"
+
+/*
+ * Allocate an empty trie node
+ *
+ * RETURN (struct trie_node* node)
+ * - NULL | Failed to allocate node
+ */
+struct trie_node* trie_create(void)
+{
+  return calloc(1, sizeof(struct trie_node));
+}
+
+/*
+ * Free trie node, and all nodes below it
+ */
+void trie_free(struct trie_node* root)
+{
+  if(!root) return;
+
+  for(int index = 0; index < 16; index++)
+  {
+    trie_free(root->children[index]);
+  }
+
+  free(root->subscribers);
+
+  free(root);
+}
+
+/*
+ * Walk down to the node of key, optionally creating missing nodes
+ *
+ * RETURN (struct trie_node* node)
+ * - NULL | The node doesn't exist, or failed to create it
+ */
+static struct trie_node* trie_node_find(struct trie_node* root, const char* key, size_t length, bool create)
+{
+  struct trie_node* node = root;
+
+  for(size_t index = 0; index < length * 2; index++)
+  {
+    unsigned char byte = key[index / 2];
+
+    int nibble = (index % 2 == 0) ? (byte >> 4) : (byte & 0x0f);
+
+    if(!node->children[nibble])
+    {
+      if(!create || !(node->children[nibble] = trie_create())) return NULL;
+    }
+
+    node = node->children[nibble];
+  }
+
+  return node;
+}
+
+/*
+ * Add subscriber to key
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * -  1 | Already subscribed
+ * - -1 | Failed to allocate memory
+ */
+int trie_insert(struct trie_node* root, const char* key, size_t length, int subscriber)
+{
+  struct trie_node* node = trie_node_find(root, key, length, true);
+
+  if(!node) return -1;
+
+  for(int index = 0; index < node->count; index++)
+  {
+    if(node->subscribers[index] == subscriber) return 1;
+  }
+
+  if(node->count == node->capacity)
+  {
+    int capacity = (node->capacity > 0) ? node->capacity * 2 : 4;
+
+    int* subscribers = realloc(node->subscribers, sizeof(int) * capacity);
+
+    if(!subscribers) return -1;
+
+    node->subscribers = subscribers;
+    node->capacity    = capacity;
+  }
+
+  node->subscribers[node->count++] = subscriber;
+
+  return 0;
+}
+
+/*
+ * Remove subscriber from key
+ *
+ * Note: Emptied nodes are kept, to be reused by later subscriptions
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Not subscribed
+ */
+int trie_remove(struct trie_node* root, const char* key, size_t length, int subscriber)
+{
+  struct trie_node* node = trie_node_find(root, key, length, false);
+
+  if(!node) return 1;
+
+  for(int index = 0; index < node->count; index++)
+  {
+    if(node->subscribers[index] == subscriber)
+    {
+      node->subscribers[index] = node->subscribers[--node->count];
+
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/*
+ * Call match for every subscriber of every prefix of key,
+ * including the empty prefix and the whole key
+ *
+ * The cost is linear in the key length, plus the number of matches
+ */
+void trie_prefixes_match(struct trie_node* root, const char* key, size_t length, void (*match) (int, void*), void* arg)
+{
+  struct trie_node* node = root;
+
+  for(size_t index = 0; node; index++)
+  {
+    // Only whole bytes are prefixes, the nodes between them have no subscribers
+    if(index % 2 == 0)
+    {
+      for(int sub_index = 0; sub_index < node->count; sub_index++)
+      {
+        match(node->subscribers[sub_index], arg);
+      }
+    }
+
+    if(index == length * 2) break;
+
+    unsigned char byte = key[index / 2];
+
+    node = node->children[(index % 2 == 0) ? (byte >> 4) : (byte & 0x0f)];
+  }
+}
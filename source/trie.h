@@ -0,0 +1,41 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef TRIE_H
+#define TRIE_H
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*
+ * Node of a prefix trie over the nibbles of the keys
+ *
+ * Every byte of a key is two steps down the trie, which keeps the nodes
+ * small (16 children), while a lookup stays linear in the key length
+ *
+ * The subscribers of a key are stored in the node of its last byte
+ */
+struct trie_node
+{
+  struct trie_node* children[16];
+  int*              subscribers;
+  int               count;
+  int               capacity;
+};
+
+extern struct trie_node* trie_create(void);
+
+extern void trie_free(struct trie_node* root);
+
+extern int  trie_insert(struct trie_node* root, const char* key, size_t length, int subscriber);
+
+extern int  trie_remove(struct trie_node* root, const char* key, size_t length, int subscriber);
+
+extern void trie_prefixes_match(struct trie_node* root, const char* key, size_t length, void (*match) (int, void*), void* arg);
+
+#endif // TRIE_H
@@ -0,0 +1,425 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#include "uring.h"
+
+/*
+ * io_uring instance, with mapped rings and registered buffers
+ */
+struct uring
+{
+  int                  fd;
+  void*                sq_ring;
+  size_t               sq_ring_size;
+  void*                cq_ring;
+  size_t               cq_ring_size;
+  struct io_uring_sqe* sqes;
+  size_t               sqes_size;
+  unsigned*            sq_tail;
+  unsigned*            sq_mask;
+  unsigned*            sq_array;
+  unsigned*            cq_head;
+  unsigned*            cq_tail;
+  unsigned*            cq_mask;
+  struct io_uring_cqe* cqes;
+  unsigned             prepared;
+  char*                buffers;
+  size_t               submissions;
+};
+
+/*
+ * State of a registered buffer in the relay
+ */
+struct uring_buffer
+{
+  size_t length;
+  size_t offset;
+  bool   filled;
+};
+
+#define URING_READ  0
+#define URING_WRITE 1
+
+/*
+ * Unmap the rings and buffers, and close the io_uring instance
+ */
+static void uring_free(struct uring* uring)
+{
+  if(uring->buffers) munmap(uring->buffers, URING_BUFFERS * URING_BUFFER_SIZE);
+
+  if(uring->sqes) munmap(uring->sqes, uring->sqes_size);
+
+  if(uring->cq_ring && uring->cq_ring != uring->sq_ring) munmap(uring->cq_ring, uring->cq_ring_size);
+
+  if(uring->sq_ring) munmap(uring->sq_ring, uring->sq_ring_size);
+
+  if(uring->fd != -1) close(uring->fd);
+}
+
+/*
+ * Map the submission and completion rings of the io_uring instance
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to map rings
+ */
+static int uring_rings_map(struct uring* uring, struct io_uring_params* params)
+{
+  uring->sq_ring_size = params->sq_off.array + params->sq_entries * sizeof(unsigned);
+  uring->cq_ring_size = params->cq_off.cqes  + params->cq_entries * sizeof(struct io_uring_cqe);
+
+  // Newer kernels map both rings with a single mmap
+  if(params->features & IORING_FEAT_SINGLE_MMAP)
+  {
+    if(uring->cq_ring_size > uring->sq_ring_size) uring->sq_ring_size = uring->cq_ring_size;
+
+    uring->cq_ring_size = uring->sq_ring_size;
+  }
+
+  uring->sq_ring = mmap(NULL, uring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQ_RING);
+
+  if(uring->sq_ring == MAP_FAILED)
+  {
+    uring->sq_ring = NULL;
+
+    return -1;
+  }
+
+  if(params->features & IORING_FEAT_SINGLE_MMAP)
+  {
+    uring->cq_ring = uring->sq_ring;
+  }
+  else
+  {
+    uring->cq_ring = mmap(NULL, uring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_CQ_RING);
+
+    if(uring->cq_ring == MAP_FAILED)
+    {
+      uring->cq_ring = NULL;
+
+      return -1;
+    }
+  }
+
+  uring->sqes_size = params->sq_entries * sizeof(struct io_uring_sqe);
+
+  uring->sqes = mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQES);
+
+  if(uring->sqes == MAP_FAILED)
+  {
+    uring->sqes = NULL;
+
+    return -1;
+  }
+
+  char* sq_ring = uring->sq_ring;
+  char* cq_ring = uring->cq_ring;
+
+  uring->sq_tail  = (unsigned*) (sq_ring + params->sq_off.tail);
+  uring->sq_mask  = (unsigned*) (sq_ring + params->sq_off.ring_mask);
+  uring->sq_array = (unsigned*) (sq_ring + params->sq_off.array);
+
+  uring->cq_head  = (unsigned*) (cq_ring + params->cq_off.head);
+  uring->cq_tail  = (unsigned*) (cq_ring + params->cq_off.tail);
+  uring->cq_mask  = (unsigned*) (cq_ring + params->cq_off.ring_mask);
+  uring->cqes     = (struct io_uring_cqe*) (cq_ring + params->cq_off.cqes);
+
+  return 0;
+}
+
+/*
+ * Allocate the buffers and register them as fixed buffers,
+ * so the kernel doesn't have to map them for every request
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to allocate or register buffers
+ */
+static int uring_buffers_register(struct uring* uring)
+{
+  uring->buffers = mmap(NULL, URING_BUFFERS * URING_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if(uring->buffers == MAP_FAILED)
+  {
+    uring->buffers = NULL;
+
+    return -1;
+  }
+
+  struct iovec iovecs[URING_BUFFERS];
+
+  for(int index = 0; index < URING_BUFFERS; index++)
+  {
+    iovecs[index].iov_base = uring->buffers + index * URING_BUFFER_SIZE;
+    iovecs[index].iov_len  = URING_BUFFER_SIZE;
+  }
+
+  if(syscall(__NR_io_uring_register, uring->fd, IORING_REGISTER_BUFFERS, iovecs, URING_BUFFERS) == -1) return -1;
+
+  return 0;
+}
+
+/*
+ * Create io_uring instance, map its rings and register its buffers
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | io_uring is not available
+ */
+static int uring_init(struct uring* uring)
+{
+  memset(uring, 0, sizeof(struct uring));
+
+  struct io_uring_params params;
+
+  memset(&params, 0, sizeof(params));
+
+  uring->fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+
+  if(uring->fd == -1) return -1;
+
+  if(uring_rings_map(uring, &params) == -1 || uring_buffers_register(uring) == -1)
+  {
+    uring_free(uring);
+
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * Prepare a read or write request on a registered buffer
+ *
+ * The request is not submitted until uring_submit_wait is called,
+ * so that several requests are batched in one submission
+ */
+static void uring_prepare(struct uring* uring, int opcode, int fd, int index, char* buffer, size_t length, int operation)
+{
+  unsigned tail = *uring->sq_tail + uring->prepared;
+
+  unsigned slot = tail & *uring->sq_mask;
+
+  struct io_uring_sqe* sqe = &uring->sqes[slot];
+
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+  sqe->opcode    = opcode;
+  sqe->fd        = fd;
+  sqe->addr      = (uint64_t) (uintptr_t) buffer;
+  sqe->len       = length;
+  sqe->off       = (uint64_t) -1; // Current file position, for stdin files
+  sqe->buf_index = index;
+  sqe->user_data = (index << 1) | operation;
+
+  uring->sq_array[slot] = slot;
+
+  uring->prepared++;
+}
+
+/*
+ * Submit the prepared requests and wait for at least one completion,
+ * using a single io_uring_enter call
+ *
+ * RETURN (int status)
+ * -  0 | Success, at least one request has completed
+ * - -1 | Failed to submit, or interrupted
+ */
+static int uring_submit_wait(struct uring* uring)
+{
+  // Make the prepared requests visible to the kernel
+  __atomic_store_n(uring->sq_tail, *uring->sq_tail + uring->prepared, __ATOMIC_RELEASE);
+
+  int status = syscall(__NR_io_uring_enter, uring->fd, uring->prepared, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+
+  uring->submissions++;
+
+  if(status == -1) return -1;
+
+  uring->prepared = 0;
+
+  // A signal interrupted the wait, after the requests were submitted
+  if(*uring->cq_head == __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE))
+  {
+    errno = EINTR;
+
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * Count the lines in a chunk of bytes
+ */
+static size_t lines_count(const char* buffer, size_t length)
+{
+  size_t count = 0;
+
+  const char* end = buffer + length;
+
+  while((buffer = memchr(buffer, '\n', end - buffer)))
+  {
+    count++;
+
+    buffer++;
+  }
+
+  return count;
+}
+
+/*
+ * Relay bytes from input to output through the registered buffers
+ *
+ * The next read is kept in flight while earlier buffers are being written,
+ * and both requests are submitted together
+ *
+ * RETURN (same as uring_relay)
+ */
+static int uring_buffers_relay(struct uring* uring, int in_fd, int out_fd, size_t* moved, size_t* lines)
+{
+  struct uring_buffer buffers[URING_BUFFERS];
+
+  memset(buffers, 0, sizeof(buffers));
+
+  int read_index = 0, write_index = 0;
+
+  bool reading = false, writing = false, eof = false;
+
+  while(true)
+  {
+    // 1. Keep a read in flight, as long as there is a free buffer
+    if(!reading && !eof && !buffers[read_index].filled)
+    {
+      char* buffer = uring->buffers + read_index * URING_BUFFER_SIZE;
+
+      uring_prepare(uring, IORING_OP_READ_FIXED, in_fd, read_index, buffer, URING_BUFFER_SIZE, URING_READ);
+
+      reading = true;
+    }
+
+    // 2. Keep a write in flight, as long as there is a filled buffer
+    if(!writing && buffers[write_index].filled)
+    {
+      struct uring_buffer* state = &buffers[write_index];
+
+      char* buffer = uring->buffers + write_index * URING_BUFFER_SIZE + state->offset;
+
+      uring_prepare(uring, IORING_OP_WRITE_FIXED, out_fd, write_index, buffer, state->length - state->offset, URING_WRITE);
+
+      writing = true;
+    }
+
+    if(!reading && !writing) return 0; // End Of File, everything is written
+
+    if(uring_submit_wait(uring) == -1) return 3;
+
+    // 3. Handle the completed requests
+    unsigned head = *uring->cq_head;
+
+    unsigned tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+
+    for(; head != tail; head++)
+    {
+      struct io_uring_cqe* cqe = &uring->cqes[head & *uring->cq_mask];
+
+      int index = cqe->user_data >> 1;
+
+      if(cqe->res < 0)
+      {
+        errno = -cqe->res;
+
+        __atomic_store_n(uring->cq_head, head + 1, __ATOMIC_RELEASE);
+
+        // The input can't be read with io_uring, nothing has been moved
+        if((cqe->user_data & 1) == URING_READ && *moved == 0 && (errno == EINVAL || errno == EOPNOTSUPP))
+        {
+          errno = 0;
+
+          return 1;
+        }
+
+        return 3;
+      }
+
+      if((cqe->user_data & 1) == URING_READ)
+      {
+        reading = false;
+
+        if(cqe->res == 0) eof = true;
+        else
+        {
+          buffers[index].filled = true;
+          buffers[index].length = cqe->res;
+          buffers[index].offset = 0;
+
+          *lines += lines_count(uring->buffers + index * URING_BUFFER_SIZE, cqe->res);
+
+          read_index = (read_index + 1) % URING_BUFFERS;
+        }
+      }
+      else
+      {
+        writing = false;
+
+        // Continue partial writes where they stopped
+        buffers[index].offset += cqe->res;
+
+        *moved += cqe->res;
+
+        if(buffers[index].offset == buffers[index].length)
+        {
+          buffers[index].filled = false;
+
+          write_index = (write_index + 1) % URING_BUFFERS;
+        }
+      }
+    }
+
+    __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+  }
+}
+
+/*
+ * Relay bytes from input to output with io_uring,
+ * instead of blocking read and write calls
+ *
+ * RETURN (int status)
+ * - 0 | Success, end of file
+ * - 1 | io_uring is not available, fall back to buffered relay
+ * - 3 | Failed to relay
+ */
+int uring_relay(int in_fd, int out_fd, bool debug)
+{
+  struct uring uring;
+
+  if(uring_init(&uring) == -1)
+  {
+    if(debug) info_print("io_uring is not available (%s), falling back to buffered relay", strerror(errno));
+
+    errno = 0;
+
+    return 1;
+  }
+
+  size_t moved = 0, lines = 0;
+
+  int status = uring_buffers_relay(&uring, in_fd, out_fd, &moved, &lines);
+
+  if(status == 1)
+  {
+    if(debug) info_print("Can't use io_uring (%d) => (%d), falling back to buffered relay", in_fd, out_fd);
+  }
+  else if(debug)
+  {
+    info_print("Relayed %ld bytes (%ld lines) (%d) => (%d) with %ld submissions (%f submissions per line)", (long) moved, (long) lines,
+      in_fd, out_fd, (long) uring.submissions, (double) uring.submissions / (lines ? lines : 1));
+  }
+
+  uring_free(&uring);
+
+  return status;
+}
@@ -0,0 +1,28 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef URING_H
+#define URING_H
+
+#include "debug.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#define URING_ENTRIES     8
+#define URING_BUFFERS     4
+#define URING_BUFFER_SIZE 65536
+
+extern int uring_relay(int in_fd, int out_fd, bool debug);
+
+#endif // URING_H
@@ -0,0 +1,379 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#include "writer.h"
+
+/*
+ * Initialize writer for an endpoint, allocating its send buffer from the message pool
+ *
+ * PARAMS
+ * - int fd        | File descriptor of the endpoint
+ * - ssize_t flush | Function writing iovecs to the endpoint (buffer_write or socket_write)
+ * - size_t size   | Size of the send buffer
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to allocate send buffer
+ */
+int writer_init(struct writer* writer, int fd, ssize_t (*flush) (int, const struct iovec*, int), size_t size)
+{
+  writer->buffer = pool_alloc(size);
+
+  if(!writer->buffer) return -1;
+
+  writer->fd       = fd;
+  writer->flush    = flush;
+  writer->size     = size;
+  writer->start    = 0;
+  writer->end      = 0;
+  writer->pending  = 0;
+  writer->syscalls = 0;
+  writer->lines    = 0;
+  writer->counters  = NULL;
+  writer->histogram = NULL;
+  writer->blocked   = 0;
+
+  return 0;
+}
+
+/*
+ * Free the send buffer of writer
+ */
+void writer_free(struct writer* writer)
+{
+  pool_release(writer->buffer);
+
+  writer->buffer = NULL;
+}
+
+/*
+ * Wait until the endpoint can be written to
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to wait, or interrupted
+ */
+static int writer_wait(struct writer* writer)
+{
+  struct pollfd pollfd = { .fd = writer->fd, .events = POLLOUT };
+
+  if(poll(&pollfd, 1, -1) == -1) return -1;
+
+  return 0;
+}
+
+/*
+ * Write the iovecs to the endpoint with a single call to flush
+ *
+ * RETURN (same as flush)
+ */
+static ssize_t writer_iovecs_flush(struct writer* writer, const struct iovec* iovecs, int count)
+{
+  ssize_t status = writer->flush(writer->fd, iovecs, count);
+
+  writer->syscalls++;
+
+  COUNTER_ADD(writer->counters, syscalls, 1);
+
+  if(status > 0)
+  {
+    COUNTER_ADD(writer->counters, bytes, status);
+
+    size_t length = 0;
+
+    for(int index = 0; index < count; index++) length += iovecs[index].iov_len;
+
+    if((size_t) status < length) COUNTER_ADD(writer->counters, partials, 1);
+  }
+  // Interrupts are how the routines are stopped, not errors
+  else if(status == -1 && errno != EINTR)
+  {
+    if(errno == EAGAIN || errno == EWOULDBLOCK) COUNTER_ADD(writer->counters, eagains, 1);
+
+    else COUNTER_ADD(writer->counters, errors, 1);
+  }
+
+  return status;
+}
+
+/*
+ * Start timing how long the writer is blocked in flush
+ */
+static long writer_timer_start(const struct writer* writer)
+{
+  return writer->histogram ? histogram_time() : 0;
+}
+
+/*
+ * Stop timing how long the writer is blocked in flush, and record it
+ */
+static void writer_timer_stop(struct writer* writer, long start)
+{
+  if(!writer->histogram) return;
+
+  long elapsed = histogram_time() - start;
+
+  writer->blocked += elapsed;
+
+  histogram_record(writer->histogram, elapsed);
+}
+
+/*
+ * Write all bytes of the iovecs, continuing partial writes
+ * where they stopped and waiting while the endpoint is full
+ *
+ * Note: The iovecs are modified to keep track of the written bytes
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to write to endpoint
+ */
+static int writer_iovecs_write(struct writer* writer, struct iovec* iovecs, int count)
+{
+  long start = writer_timer_start(writer);
+
+  while(count > 0)
+  {
+    ssize_t status = writer_iovecs_flush(writer, iovecs, count);
+
+    if(status == -1)
+    {
+      // The endpoint is full, wait until it can be written to again
+      if(errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        errno = 0;
+
+        if(writer_wait(writer) == -1) break;
+
+        continue;
+      }
+
+      break; // ERROR
+    }
+
+    if(status == 0) break; // End Of File
+
+    // Skip the written iovecs and cut the partially written iovec
+    for(; count > 0 && (size_t) status >= iovecs->iov_len; iovecs++, count--)
+    {
+      status -= iovecs->iov_len;
+    }
+
+    if(count > 0)
+    {
+      iovecs->iov_base = (char*) iovecs->iov_base + status;
+      iovecs->iov_len -= status;
+    }
+  }
+
+  writer_timer_stop(writer, start);
+
+  return (count > 0) ? -1 : 0;
+}
+
+/*
+ * Mark the pending lines in the send buffer as sent
+ */
+static void writer_reset(struct writer* writer)
+{
+  writer->lines  += writer->pending;
+
+  COUNTER_ADD(writer->counters, lines, writer->pending);
+
+  writer->pending = 0;
+
+  writer->start = 0;
+  writer->end   = 0;
+}
+
+/*
+ * Send all pending lines in the send buffer, using as few syscalls as possible
+ *
+ * RETURN (int status)
+ * -  0 | Success
+ * - -1 | Failed to write to endpoint
+ */
+int writer_flush(struct writer* writer)
+{
+  if(writer->start == writer->end) return 0;
+
+  struct iovec iovecs[1] =
+  {
+    { .iov_base = writer->buffer + writer->start, .iov_len = writer->end - writer->start }
+  };
+
+  if(writer_iovecs_write(writer, iovecs, 1) == -1) return -1;
+
+  writer_reset(writer);
+
+  return 0;
+}
+
+/*
+ * Move the unsent bytes to the start of the send buffer,
+ * to make room for more lines
+ */
+static void writer_compact(struct writer* writer)
+{
+  if(writer->start == 0) return;
+
+  memmove(writer->buffer, writer->buffer + writer->start, writer->end - writer->start);
+
+  writer->end  -= writer->start;
+  writer->start = 0;
+}
+
+/*
+ * Send the pending lines without waiting, for non-blocking endpoints
+ *
+ * If the endpoint is full, the unsent bytes are kept for the next call
+ *
+ * RETURN (int status)
+ * -  0 | Success, all pending lines are sent
+ * -  1 | The endpoint is full, some bytes are still pending
+ * - -1 | Failed to write to endpoint
+ */
+int writer_flush_nonblock(struct writer* writer)
+{
+  while(writer->start < writer->end)
+  {
+    struct iovec iovecs[1] =
+    {
+      { .iov_base = writer->buffer + writer->start, .iov_len = writer->end - writer->start }
+    };
+
+    long start = writer_timer_start(writer);
+
+    ssize_t status = writer_iovecs_flush(writer, iovecs, 1);
+
+    writer_timer_stop(writer, start);
+
+    if(status == -1)
+    {
+      if(errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        errno = 0;
+
+        writer_compact(writer);
+
+        return 1;
+      }
+
+      return -1; // ERROR
+    }
+
+    if(status == 0) return -1; // End Of File
+
+    writer->start += status;
+  }
+
+  writer_reset(writer);
+
+  return 0;
+}
+
+/*
+ * Check if there are bytes in the send buffer waiting to be sent
+ */
+bool writer_pending(const struct writer* writer)
+{
+  return writer->start < writer->end;
+}
+
+/*
+ * Add bytes to the send buffer
+ *
+ * If the bytes don't fit in the send buffer, the pending bytes are sent first.
+ * A large chunk of bytes is sent right away, in the same syscall as the pending bytes,
+ * without being copied to the send buffer
+ *
+ * RETURN (ssize_t size)
+ * - >0 | Success! The number of bytes
+ * -  0 | No bytes to write
+ * - -1 | Failed to write to endpoint
+ */
+ssize_t writer_write(struct writer* writer, const char* bytes, size_t length)
+{
+  if(!bytes || length == 0) return 0;
+
+  if(writer->end + length > writer->size)
+  {
+    if(length > writer->size / 2)
+    {
+      struct iovec iovecs[2] =
+      {
+        { .iov_base = writer->buffer + writer->start, .iov_len = writer->end - writer->start },
+        { .iov_base = (char*) bytes,                  .iov_len = length }
+      };
+
+      if(writer_iovecs_write(writer, iovecs, 2) == -1) return -1;
+
+      writer_reset(writer);
+
+      return length;
+    }
+
+    if(writer_flush(writer) == -1) return -1;
+  }
+
+  memcpy(writer->buffer + writer->end, bytes, length);
+
+  writer->end += length;
+
+  return length;
+}
+
+/*
+ * Add a line to the batch of pending lines
+ *
+ * RETURN (same as writer_write)
+ */
+ssize_t writer_line_write(struct writer* writer, const char* line, size_t length)
+{
+  // Count the line before it is written, because it might be sent right away
+  if(line && length > 0) writer->pending++;
+
+  return writer_write(writer, line, length);
+}
+
+/*
+ * Add a chunk of lines to the batch of pending lines
+ *
+ * The chunk can hold any number of lines, and can end with a part of a line,
+ * which is counted once its newline has been written
+ *
+ * RETURN (same as writer_write)
+ */
+ssize_t writer_lines_write(struct writer* writer, const char* lines, size_t length)
+{
+  if(!lines || length == 0) return 0;
+
+  // Count the lines before they are written, because they might be sent right away
+  for(const char* line = lines; (line = memchr(line, '\n', lines + length - line)); line++)
+  {
+    writer->pending++;
+  }
+
+  return writer_write(writer, lines, length);
+}
+
+/*
+ * Add the header of a frame to the batch of pending frames
+ *
+ * The payload has to be written with writer_write afterwards
+ *
+ * RETURN (same as writer_write)
+ */
+ssize_t writer_frame_header_write(struct writer* writer, uint32_t length)
+{
+  char header[FRAME_HEADER_SIZE];
+
+  frame_header_encode(header, length);
+
+  writer->pending++;
+
+  return writer_write(writer, header, FRAME_HEADER_SIZE);
+}
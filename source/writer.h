@@ -0,0 +1,72 @@
+/*
+ * Written by Hampus Fridholm
+ *
+ * Last updated: 2026-10-15
+ */
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include "debug.h"
+#include "frame.h"
+#include "pool.h"
+#include "counter.h"
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/uio.h>
+
+#define WRITER_SIZE 65536
+
+/*
+ * Coalescing line writer for one endpoint
+ *
+ * Lines are collected in the send buffer and sent as a batch,
+ * using a single call to flush (writev or sendmsg)
+ *
+ * In binary mode, frames are written as a header followed by chunks
+ * of the payload, and are counted as lines
+ *
+ * If counters is set, the writer also counts its activity there,
+ * and if histogram is set, it records the time it is blocked in flush there
+ */
+struct writer
+{
+  int     fd;
+  ssize_t (*flush) (int, const struct iovec*, int);
+  char*   buffer;
+  size_t  size;
+  size_t  start;
+  size_t  end;
+  size_t  pending;
+  size_t  syscalls;
+  size_t  lines;
+  struct counters* counters;
+  struct histogram* histogram;
+  long    blocked;
+};
+
+extern int     writer_init(struct writer* writer, int fd, ssize_t (*flush) (int, const struct iovec*, int), size_t size);
+
+extern void    writer_free(struct writer* writer);
+
+extern ssize_t writer_write(struct writer* writer, const char* bytes, size_t length);
+
+extern ssize_t writer_line_write(struct writer* writer, const char* line, size_t length);
+
+extern ssize_t writer_lines_write(struct writer* writer, const char* lines, size_t length);
+
+extern ssize_t writer_frame_header_write(struct writer* writer, uint32_t length);
+
+extern int     writer_flush(struct writer* writer);
+
+extern int     writer_flush_nonblock(struct writer* writer);
+
+extern bool    writer_pending(const struct writer* writer);
+
+#endif // WRITER_H
@@ -0,0 +1,67 @@
+#!/bin/sh
+#
+# Written by Hampus Fridholm
+#
+# Last updated: 2026-10-16
+#
+# Smoke test of the debug messages (-d): a fifo => socket => fifo relay
+# has to log the payload of every relayed line, in both procoms
+#
+# Usage: debug-smoke.sh PROCOM [PORT]
+
+PROCOM=${1:-./procom}
+PORT=${2:-5570}
+
+DIR=$(mktemp -d)
+
+trap 'kill $SERVER $CLIENT $SINK 2> /dev/null; rm -rf "$DIR"' EXIT
+
+mkfifo "$DIR/in" "$DIR/out"
+
+# The server reads its stdin until the end of the test, to keep running
+sleep 3 | timeout 4 "$PROCOM" -p "$PORT" -o "$DIR/out" -d > "$DIR/server.log" 2>&1 &
+SERVER=$!
+
+sleep 0.2
+
+timeout 4 cat "$DIR/out" > "$DIR/received" &
+SINK=$!
+
+timeout 4 "$PROCOM" -p "$PORT" -i "$DIR/in" -d > "$DIR/client.log" 2>&1 &
+CLIENT=$!
+
+sleep 0.2
+
+printf 'smoke line one\nsmoke line two with %%s and %%d\nsmoke line three\n' > "$DIR/in"
+
+sleep 0.5
+
+kill $SERVER $CLIENT 2> /dev/null
+
+wait 2> /dev/null
+
+STATUS=0
+
+# Every line has to be relayed, and logged with its payload on both sides
+for LINE in "smoke line one" "smoke line two with %s and %d" "smoke line three"
+do
+  if ! grep -qF "$LINE" "$DIR/received"; then
+    echo "FAIL: not relayed: $LINE"; STATUS=1
+  fi
+
+  if ! grep -aqF "[ FIFO => SOCKET ]: $LINE" "$DIR/client.log"; then
+    echo "FAIL: not logged by client: $LINE"; STATUS=1
+  fi
+
+  if ! grep -aqF "[ SOCKET => FIFO ]: $LINE" "$DIR/server.log"; then
+    echo "FAIL: not logged by server: $LINE"; STATUS=1
+  fi
+done
+
+if grep -aqF "UNSUPPORTED" "$DIR/client.log" "$DIR/server.log"; then
+  echo "FAIL: the logger met an unsupported conversion"; STATUS=1
+fi
+
+if [ $STATUS -eq 0 ]; then echo "PASS: debug-smoke"; fi
+
+exit $STATUS
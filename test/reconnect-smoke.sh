@@ -0,0 +1,63 @@
+#!/bin/sh
+#
+# Written by Hampus Fridholm
+#
+# Last updated: 2026-10-16
+#
+# Smoke test of reconnect mode (-R): a connection that is lost in the middle of a line
+# is replaced by a new one, over which the peer sends the whole line again,
+# so the part of the line from the lost connection must not be written
+#
+# The peer is played by a small python server
+#
+# Usage: reconnect-smoke.sh PROCOM [PORT]
+
+PROCOM=${1:-./procom}
+PORT=${2:-5571}
+
+if ! command -v python3 > /dev/null; then
+  echo "SKIP: reconnect-smoke needs python3"; exit 0
+fi
+
+DIR=$(mktemp -d)
+
+trap 'kill $PEER 2> /dev/null; rm -rf "$DIR"' EXIT
+
+python3 - "$PORT" > "$DIR/peer.log" 2>&1 << 'PYTHON' &
+import socket, sys, time
+
+server = socket.socket()
+server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+server.bind(("127.0.0.1", int(sys.argv[1])))
+server.listen(1)
+
+# The first connection is lost in the middle of a line
+client, _ = server.accept()
+client.sendall(b"complete one\nhalf of a li")
+time.sleep(0.2)
+client.close()
+
+# The new connection starts with the whole line again
+client, _ = server.accept()
+client.sendall(b"half of a line\ncomplete two\n")
+time.sleep(0.5)
+client.close()
+PYTHON
+PEER=$!
+
+sleep 0.3
+
+# The stdin is kept open, for procom to keep reconnecting
+sleep 2 | timeout 3 "$PROCOM" -p "$PORT" -R > "$DIR/received" 2> "$DIR/procom.log"
+
+printf 'complete one\nhalf of a line\ncomplete two\n' > "$DIR/expected"
+
+if cmp -s "$DIR/expected" "$DIR/received"; then
+  echo "PASS: reconnect-smoke"; exit 0
+fi
+
+echo "FAIL: reconnect-smoke, expected:"; cat "$DIR/expected"
+
+echo "received:"; cat "$DIR/received"
+
+exit 1